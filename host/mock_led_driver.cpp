@@ -0,0 +1,31 @@
+#include "mock_led_driver.h"
+#include "config.h"
+
+// Mock LED Driver State Variables
+std::vector<MockFrame> mockFrames;
+uint32_t mockWaitIdleCalls = 0;
+
+static bool mockBegin()
+{
+    return true;
+}
+
+static void mockSubmit(const CRGB *frame, uint8_t brightness)
+{
+    // Copied like the real drivers, so the caller may reuse its buffer at once
+    mockFrames.push_back({std::vector<CRGB>(frame, frame + NUM_LEDS), brightness});
+    ledOutputStats.frames++;
+}
+
+static void mockWaitIdle()
+{
+    mockWaitIdleCalls++;
+}
+
+const LedDriver mockLedDriver = {"mock", mockBegin, mockSubmit, mockWaitIdle};
+
+void resetMockLedDriver()
+{
+    mockFrames.clear();
+    mockWaitIdleCalls = 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "led_output.h"
+#include <vector>
+
+// Host mock of the LED driver interface: keeps every submitted frame and
+// its brightness instead of transmitting, for tests of the render loop.
+struct MockFrame
+{
+    std::vector<CRGB> pixels;
+    uint8_t brightness;
+};
+
+// Mock LED Driver Functions
+void resetMockLedDriver();
+
+// Mock LED Driver State Variables
+extern const LedDriver mockLedDriver;
+extern std::vector<MockFrame> mockFrames;
+extern uint32_t mockWaitIdleCalls;
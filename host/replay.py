@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+"""Replays recorded serial and HTTP traffic against the host simulator and
+reports command-to-photon latency. See HOST_SIMULATION_GUIDE.md.
+
+Recordings use the same format as test_usb_serial.sh replay, one input per
+line ('#' starts a comment):
+    <ms> serial <command text>
+    <ms> http [GET|POST] <path> [<body>]
+The method is optional and defaults to POST, as in the shell script.
+"""
+
+import argparse
+import http.client
+import os
+import select
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import tty
+import urllib.parse
+
+HTTP_PORT = 18080
+HTTP_METHODS = ("GET", "POST", "PUT", "DELETE")
+
+
+def load_recording(path):
+    inputs = []
+    with open(path) as recording:
+        for number, line in enumerate(recording, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            fields = line.split(" ", 2)
+            if len(fields) < 3 or fields[1] not in ("serial", "http"):
+                sys.exit(f"{path}:{number}: expected '<ms> serial|http ...'")
+            at_ms = float(fields[0])
+            if fields[1] == "serial":
+                inputs.append({"at": at_ms, "kind": "serial", "text": fields[2]})
+            else:
+                request = fields[2].split(" ", 1)
+                method = "POST"
+                if request[0] in HTTP_METHODS:
+                    method = request[0]
+                    request = request[1].split(" ", 1) if len(request) > 1 else [""]
+                inputs.append({"at": at_ms, "kind": "http", "method": method, "path": request[0],
+                               "body": request[1] if len(request) > 1 else ""})
+    return sorted(inputs, key=lambda entry: entry["at"])
+
+
+def extract_recording(trace_path):
+    """Turns the inputs seen in a simulator trace back into a recording."""
+    start = None
+    for line in open(trace_path):
+        fields = line.rstrip("\n").split(" ", 3)
+        if len(fields) < 3 or fields[1] not in ("line", "http"):
+            continue
+        at_ns = int(fields[0])
+        start = at_ns if start is None else start
+        at_ms = (at_ns - start) / 1e6
+        if fields[1] == "line":
+            print(f"{at_ms:.1f} serial {fields[3] if len(fields) > 3 else ''}")
+        else:
+            method, path, body = (fields[3].split(" ", 2) + ["", ""])[:3]
+            body = "" if body == "-" else urllib.parse.unquote(body)
+            method = "" if method == "POST" else method + " "
+            print(f"{at_ms:.1f} http {method}{path} {body}".rstrip())
+
+
+class Simulator:
+    def __init__(self, binary, workdir, extra_args):
+        self.pty_path = os.path.join(workdir, "serial.pty")
+        self.trace_path = os.path.join(workdir, "trace.txt")
+        arguments = [binary, "--pty", self.pty_path, "--trace", self.trace_path,
+                     "--fs", os.path.join(workdir, "fs"), "--http-port", str(HTTP_PORT)] + extra_args
+        self.process = subprocess.Popen(arguments, stderr=subprocess.DEVNULL)
+        self.serial = None
+
+    def wait_ready(self, timeout=10):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            if os.path.exists(self.trace_path) and " ready " in open(self.trace_path).read():
+                self.serial = os.open(self.pty_path, os.O_RDWR | os.O_NOCTTY)
+                tty.setraw(self.serial)
+                threading.Thread(target=self._drain, daemon=True).start()
+                return
+            if self.process.poll() is not None:
+                sys.exit("firmware_sim exited during setup")
+            time.sleep(0.05)
+        sys.exit("firmware_sim did not come up")
+
+    def _drain(self):
+        # Responses are not checked, but must be read like a real host would
+        while True:
+            readable, _, _ = select.select([self.serial], [], [], 0.2)
+            if readable:
+                try:
+                    os.read(self.serial, 4096)
+                except OSError:
+                    return
+
+    def stop(self):
+        self.process.send_signal(signal.SIGTERM)
+        self.process.wait()
+
+
+def send_http(entry):
+    connection = http.client.HTTPConnection("127.0.0.1", HTTP_PORT, timeout=5)
+    headers = {"Content-Type": "application/json" if entry["body"].startswith("{") else "text/plain"}
+    entry["sent"] = time.monotonic_ns()
+    try:
+        connection.request(entry["method"], entry["path"], body=entry["body"] or None, headers=headers)
+        entry["status"] = connection.getresponse().status
+    except OSError:
+        entry["status"] = None
+    connection.close()
+
+
+def replay(simulator, inputs, speed):
+    start = time.monotonic_ns() + 200_000_000
+    threads = []
+    for entry in inputs:
+        entry = dict(entry)
+        due = start + int(entry["at"] * 1e6 / speed)
+        while time.monotonic_ns() < due:
+            time.sleep(min(0.002, max(0, (due - time.monotonic_ns()) / 1e9)))
+        if entry["kind"] == "serial":
+            entry["sent"] = time.monotonic_ns()
+            os.write(simulator.serial, entry["text"].encode() + b"\n")
+        else:
+            thread = threading.Thread(target=send_http, args=(entry,))
+            thread.start()
+            threads.append(thread)
+        yield entry
+    for thread in threads:
+        thread.join()
+
+
+def parse_trace(path):
+    events = {"line": [], "http": [], "frame": [], "rx": []}
+    for line in open(path):
+        fields = line.split()
+        if len(fields) >= 2 and fields[1] in events:
+            events[fields[1]].append(fields)
+    return events
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))] if ordered else float("nan")
+
+
+def analyse(sent, trace):
+    """Pairs each input with the trace event where loop() dispatched it and
+    with the first frame whose transmission started after that."""
+    frames = [(int(fields[5]), int(fields[0])) for fields in trace["frame"]]
+    dispatched = {"serial": [int(fields[0]) for fields in trace["line"]],
+                  "http": [int(fields[0]) for fields in trace["http"]]}
+    seen = {"serial": 0, "http": 0}
+
+    results = []
+    frame_index = 0
+    for entry in sorted(sent, key=lambda entry: entry["sent"]):
+        kind = entry["kind"]
+        result = {"kind": kind, "sent": entry["sent"], "dispatch": None, "frame": None}
+        if seen[kind] < len(dispatched[kind]):
+            result["dispatch"] = dispatched[kind][seen[kind]]
+            seen[kind] += 1
+            while frame_index < len(frames) and frames[frame_index][0] < result["dispatch"]:
+                frame_index += 1
+            if frame_index < len(frames):
+                result["frame"] = frame_index
+                result["latency_ms"] = (frames[frame_index][1] - entry["sent"]) / 1e6
+                result["dispatch_ms"] = (result["dispatch"] - entry["sent"]) / 1e6
+        results.append(result)
+
+    # Inputs sharing a frame were coalesced; only the newest one is visible
+    last_by_frame = {}
+    for result in results:
+        if result["frame"] is not None:
+            last_by_frame[result["frame"]] = result
+    for result in results:
+        result["coalesced"] = result["frame"] is not None and last_by_frame[result["frame"]] is not result
+    return results, frames
+
+
+def summarise(results, frames, duration_s):
+    lines = []
+    for kind in ("serial", "http", "all"):
+        chosen = [result for result in results if kind == "all" or result["kind"] == kind]
+        if not chosen:
+            continue
+        shown = [result["latency_ms"] for result in chosen if result["frame"] is not None]
+        dispatch = [result["dispatch_ms"] for result in chosen if result["frame"] is not None]
+        lost = sum(result["dispatch"] is None for result in chosen)
+        unshown = sum(result["dispatch"] is not None and result["frame"] is None for result in chosen)
+        coalesced = sum(result["coalesced"] for result in chosen)
+        lines.append(f"{kind:>6}: n={len(chosen)} p50={percentile(shown, 0.5):.2f}ms p99={percentile(shown, 0.99):.2f}ms "
+                     f"max={max(shown, default=float('nan')):.2f}ms dispatch_p50={percentile(dispatch, 0.5):.2f}ms "
+                     f"coalesced={coalesced} lost={lost} no_frame={unshown}")
+    rate = len(results) / duration_s if duration_s else 0
+    lines.append(f"offered {rate:.1f} inputs/s, {len(frames) / duration_s if duration_s else 0:.1f} frames/s")
+    return lines
+
+
+def run_once(arguments, inputs, speed):
+    with tempfile.TemporaryDirectory(prefix="replay_") as workdir:
+        simulator = Simulator(arguments.sim, workdir, arguments.sim_args)
+        try:
+            simulator.wait_ready()
+            started = time.monotonic()
+            sent = list(replay(simulator, inputs, speed))
+            duration = time.monotonic() - started
+            time.sleep(0.5)
+        finally:
+            simulator.stop()
+        if arguments.keep_trace:
+            os.replace(simulator.trace_path, arguments.keep_trace)
+            trace = parse_trace(arguments.keep_trace)
+        else:
+            trace = parse_trace(simulator.trace_path)
+    results, frames = analyse(sent, trace)
+    return results, frames, duration
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("recording", help="recorded traffic, or a trace with --extract")
+    parser.add_argument("--sim", default=os.path.join(os.path.dirname(__file__), "build", "firmware_sim"))
+    parser.add_argument("--speed", type=float, default=1.0, help="replay speed-up (1 = original timing)")
+    parser.add_argument("--sweep", action="store_true",
+                        help="double the speed until inputs are lost or p99 exceeds --p99-limit")
+    parser.add_argument("--p99-limit", type=float, default=50.0, help="latency bound for --sweep, ms")
+    parser.add_argument("--require-all", action="store_true", help="fail if any input never reached the strip")
+    parser.add_argument("--keep-trace", help="save the simulator trace here")
+    parser.add_argument("--extract", action="store_true", help="print a recording of the inputs in a trace")
+    parser.add_argument("--sim-args", nargs=argparse.REMAINDER, default=[], help="passed to firmware_sim")
+    arguments = parser.parse_args()
+
+    if arguments.extract:
+        extract_recording(arguments.recording)
+        return
+
+    inputs = load_recording(arguments.recording)
+    speed = arguments.speed
+    passed_rate = None
+    while True:
+        results, frames, duration = run_once(arguments, inputs, speed)
+        print(f"speed x{speed:g}")
+        for line in summarise(results, frames, duration):
+            print("  " + line)
+
+        failed = [result for result in results if result["frame"] is None]
+        if not arguments.sweep:
+            if arguments.require_all and failed:
+                sys.exit(f"{len(failed)} inputs never reached the strip")
+            return
+        shown = [result["latency_ms"] for result in results if result["frame"] is not None]
+        if failed or percentile(shown, 0.99) > arguments.p99_limit:
+            print(f"ceiling: x{speed / 2:g} ({passed_rate:.1f} inputs/s)" if passed_rate
+                  else "ceiling: below the starting speed")
+            return
+        passed_rate = len(inputs) / duration
+        speed *= 2
+
+
+if __name__ == "__main__":
+    main()
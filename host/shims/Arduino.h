@@ -0,0 +1,291 @@
+#pragma once
+// Host shim for the Arduino-ESP32 core: just enough of the API the firmware
+// uses, backed by the C++ library. Time comes from CLOCK_MONOTONIC and Serial
+// is a pseudo terminal (see host_sim.h).
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define IRAM_ATTR
+#define PROGMEM
+#define F(x) x
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::max;
+using std::min;
+
+class String
+{
+public:
+    String(const char *text = "") : value(text ? text : "") {}
+    String(const std::string &text) : value(text) {}
+    explicit String(char c) : value(1, c) {}
+    String(int number, unsigned char base = 10) : value(formatInteger(number, base)) {}
+    String(unsigned int number, unsigned char base = 10) : value(formatUnsigned(number, base)) {}
+    String(long number, unsigned char base = 10) : value(formatInteger(number, base)) {}
+    String(unsigned long number, unsigned char base = 10) : value(formatUnsigned(number, base)) {}
+    String(float number, unsigned int decimals = 2) : String((double)number, decimals) {}
+    String(double number, unsigned int decimals = 2)
+    {
+        char text[48];
+        snprintf(text, sizeof(text), "%.*f", (int)decimals, number);
+        value = text;
+    }
+
+    String &operator=(const char *text)
+    {
+        value = text ? text : "";
+        return *this;
+    }
+    String &operator+=(const String &other)
+    {
+        value += other.value;
+        return *this;
+    }
+    String &operator+=(const char *text)
+    {
+        value += text ? text : "";
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        value += c;
+        return *this;
+    }
+    String &operator+=(int number) { return *this += String(number); }
+    String &operator+=(unsigned int number) { return *this += String(number); }
+    String &operator+=(long number) { return *this += String(number); }
+    String &operator+=(unsigned long number) { return *this += String(number); }
+    bool concat(const String &other)
+    {
+        value += other.value;
+        return true;
+    }
+    bool concat(char c)
+    {
+        value += c;
+        return true;
+    }
+
+    friend String operator+(const String &a, const String &b) { return String(a.value + b.value); }
+    friend String operator+(const String &a, const char *b) { return String(a.value + (b ? b : "")); }
+    friend String operator+(const char *a, const String &b) { return String((a ? a : "") + b.value); }
+    friend String operator+(const String &a, char b) { return String(a.value + b); }
+
+    bool operator==(const String &other) const { return value == other.value; }
+    bool operator==(const char *text) const { return value == (text ? text : ""); }
+    bool operator!=(const String &other) const { return value != other.value; }
+    bool operator!=(const char *text) const { return !(*this == text); }
+    bool operator<(const String &other) const { return value < other.value; }
+    char operator[](unsigned int index) const { return index < value.size() ? value[index] : 0; }
+    char &operator[](unsigned int index) { return value[index]; }
+
+    unsigned int length() const { return value.size(); }
+    const char *c_str() const { return value.c_str(); }
+    bool isEmpty() const { return value.empty(); }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+    bool reserve(unsigned int size)
+    {
+        value.reserve(size);
+        return true;
+    }
+
+    void trim()
+    {
+        size_t start = 0;
+        size_t end = value.size();
+        while (start < end && isspace((unsigned char)value[start]))
+            start++;
+        while (end > start && isspace((unsigned char)value[end - 1]))
+            end--;
+        value = value.substr(start, end - start);
+    }
+    void toLowerCase()
+    {
+        for (char &c : value)
+            c = tolower((unsigned char)c);
+    }
+    void toUpperCase()
+    {
+        for (char &c : value)
+            c = toupper((unsigned char)c);
+    }
+    bool equalsIgnoreCase(const String &other) const
+    {
+        return strcasecmp(value.c_str(), other.value.c_str()) == 0 && value.size() == other.value.size();
+    }
+
+    bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return value.size() >= suffix.value.size() &&
+               value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+    }
+
+    String substring(unsigned int from) const { return substring(from, value.size()); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+            std::swap(from, to);
+        from = std::min<size_t>(from, value.size());
+        to = std::min<size_t>(to, value.size());
+        return String(value.substr(from, to - from));
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(value.find(c, from)); }
+    int indexOf(const String &text, unsigned int from = 0) const { return toIndex(value.find(text.value, from)); }
+    int lastIndexOf(char c) const { return toIndex(value.rfind(c)); }
+
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(value.c_str(), nullptr); }
+
+    void replace(const String &find, const String &with)
+    {
+        if (find.value.empty())
+            return;
+        for (size_t at = value.find(find.value); at != std::string::npos; at = value.find(find.value, at + with.value.size()))
+            value.replace(at, find.value.size(), with.value);
+    }
+    void remove(unsigned int index) { value.erase(std::min<size_t>(index, value.size())); }
+    void remove(unsigned int index, unsigned int count) { value.erase(std::min<size_t>(index, value.size()), count); }
+    void getBytes(unsigned char *out, unsigned int size, unsigned int index = 0) const
+    {
+        if (size == 0)
+            return;
+        size_t count = index < value.size() ? std::min<size_t>(size - 1, value.size() - index) : 0;
+        memcpy(out, value.data() + index, count);
+        out[count] = 0;
+    }
+
+private:
+    std::string value;
+
+    static int toIndex(size_t position) { return position == std::string::npos ? -1 : (int)position; }
+    static std::string formatInteger(long number, unsigned char base)
+    {
+        if (base == 10)
+            return std::to_string(number);
+        return number < 0 ? "-" + formatUnsigned(-(unsigned long)number, base) : formatUnsigned(number, base);
+    }
+    static std::string formatUnsigned(unsigned long number, unsigned char base)
+    {
+        std::string text;
+        do
+        {
+            text.insert(text.begin(), "0123456789abcdefghijklmnopqrstuvwxyz"[number % base]);
+            number /= base;
+        } while (number);
+        return text;
+    }
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    size_t print(const String &text) { return write(text.c_str()); }
+    size_t print(const char *text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int number, int base = 10) { return print(String(number, base)); }
+    size_t print(unsigned int number, int base = 10) { return print(String(number, base)); }
+    size_t print(long number, int base = 10) { return print(String(number, base)); }
+    size_t print(unsigned long number, int base = 10) { return print(String(number, base)); }
+    size_t print(double number, int decimals = 2) { return print(String(number, decimals)); }
+    template <typename T>
+    size_t println(const T &value)
+    {
+        return print(value) + println();
+    }
+    size_t println() { return write("\r\n"); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    virtual void flush() {}
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long ms) { timeoutMs = ms; }
+    size_t readBytes(uint8_t *buffer, size_t length);
+    size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    int timedRead();
+    unsigned long timeoutMs = 1000;
+};
+
+// Serial over a pseudo terminal. Received bytes are paced at the configured
+// baud rate, like a real UART, and onReceive() runs on the reader thread.
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    void updateBaudRate(unsigned long baud);
+    unsigned long baudRate() { return baud; }
+    int available() override;
+    int availableForWrite();
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override {}
+    void onReceive(void (*callback)(void), bool onlyOnTimeout = false);
+    size_t setRxBufferSize(size_t size);
+    size_t setTxBufferSize(size_t size) { return size; }
+    operator bool() const { return true; }
+
+private:
+    unsigned long baud = 115200;
+};
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh);
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+class EspClass
+{
+public:
+    void restart();
+    uint32_t getFreeHeap() { return 200000; }
+    uint64_t getEfuseMac() { return 0x0000A0B1C2D3E4F5ULL; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFreeSketchSpace() { return 0x180000; }
+    uint32_t getCycleCount();
+};
+extern EspClass ESP;
+
+#include "freertos/FreeRTOS.h"
+#include "host_sim.h"
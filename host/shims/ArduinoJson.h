@@ -0,0 +1,399 @@
+#pragma once
+// Host shim for the ArduinoJson 6 API the firmware uses: parsing into a
+// document, member and element lookup, as<T>(), is<T>() and "| default".
+// Values live in a small shared tree; capacities are ignored.
+#include <Arduino.h>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct JsonNode
+{
+    enum Type
+    {
+        Null,
+        Boolean,
+        Number,
+        Text,
+        Array,
+        Object
+    } type = Null;
+    bool boolean = false;
+    double number = 0;
+    std::string text;
+    std::vector<std::shared_ptr<JsonNode>> items;
+    std::vector<std::pair<std::string, std::shared_ptr<JsonNode>>> members;
+
+    std::shared_ptr<JsonNode> member(const std::string &key) const
+    {
+        for (const auto &entry : members)
+        {
+            if (entry.first == key)
+                return entry.second;
+        }
+        return nullptr;
+    }
+};
+
+class DeserializationError
+{
+public:
+    enum Code
+    {
+        Ok,
+        EmptyInput,
+        IncompleteInput,
+        InvalidInput
+    };
+
+    DeserializationError(Code code = Ok) : code(code) {}
+    explicit operator bool() const { return code != Ok; }
+    const char *c_str() const
+    {
+        static const char *names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput"};
+        return names[code];
+    }
+
+private:
+    Code code;
+};
+
+class JsonVariant
+{
+public:
+    JsonVariant() : node(std::make_shared<JsonNode>()) {}
+
+    JsonVariant operator[](const char *key) const { return child(key, -1); }
+    JsonVariant operator[](const String &key) const { return child(key.c_str(), -1); }
+    JsonVariant operator[](int index) const { return child("", index); }
+
+    bool isNull() const { return !node || node->type == JsonNode::Null; }
+    bool containsKey(const char *key) const { return node && node->type == JsonNode::Object && node->member(key); }
+    size_t size() const
+    {
+        if (!node)
+            return 0;
+        return node->type == JsonNode::Array ? node->items.size() : node->type == JsonNode::Object ? node->members.size() : 0;
+    }
+
+    template <typename T>
+    T as() const
+    {
+        if constexpr (std::is_same<T, bool>::value)
+            return node && (node->type == JsonNode::Boolean ? node->boolean : node->type == JsonNode::Number && node->number != 0);
+        else if constexpr (std::is_arithmetic<T>::value)
+            return node && node->type == JsonNode::Number ? (T)node->number : (T)0;
+        else if constexpr (std::is_same<T, const char *>::value)
+            return node && node->type == JsonNode::Text ? node->text.c_str() : nullptr;
+        else if constexpr (std::is_same<T, String>::value)
+            return node && node->type == JsonNode::Text ? String(node->text) : String("null");
+        else
+            return T(*this);
+    }
+
+    template <typename T>
+    bool is() const
+    {
+        if (!node)
+            return false;
+        if constexpr (std::is_same<T, bool>::value)
+            return node->type == JsonNode::Boolean;
+        else if constexpr (std::is_integral<T>::value)
+            return node->type == JsonNode::Number && node->number == (double)(long long)node->number;
+        else if constexpr (std::is_arithmetic<T>::value)
+            return node->type == JsonNode::Number;
+        else
+            return node->type == JsonNode::Text;
+    }
+
+    template <typename T>
+    operator T() const
+    {
+        return as<T>();
+    }
+
+    template <typename T>
+    T operator|(const T &fallback) const
+    {
+        return is<T>() ? as<T>() : fallback;
+    }
+    const char *operator|(const char *fallback) const { return is<const char *>() ? as<const char *>() : fallback; }
+
+    template <typename T>
+    JsonVariant &operator=(const T &value)
+    {
+        JsonNode &target = *materialize();
+        target = JsonNode();
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            target.type = JsonNode::Boolean;
+            target.boolean = value;
+        }
+        else if constexpr (std::is_arithmetic<T>::value)
+        {
+            target.type = JsonNode::Number;
+            target.number = value;
+        }
+        else
+        {
+            target.type = JsonNode::Text;
+            target.text = String(value).c_str();
+        }
+        return *this;
+    }
+
+protected:
+    friend DeserializationError deserializeJson(JsonVariant &document, const char *input, size_t length);
+
+    std::shared_ptr<JsonNode> node;
+
+    // A missing member or element is only created when it is written
+    std::shared_ptr<JsonVariant> owner;
+    std::string key;
+    int index = -1;
+
+    JsonVariant child(const char *childKey, int childIndex) const
+    {
+        JsonVariant result;
+        result.node = nullptr;
+        if (node && childIndex < 0 && node->type == JsonNode::Object)
+            result.node = node->member(childKey);
+        else if (node && childIndex >= 0 && node->type == JsonNode::Array && childIndex < (int)node->items.size())
+            result.node = node->items[childIndex];
+        if (!result.node)
+        {
+            result.owner = std::make_shared<JsonVariant>(*this);
+            result.key = childKey;
+            result.index = childIndex;
+        }
+        return result;
+    }
+
+    std::shared_ptr<JsonNode> materialize()
+    {
+        if (node)
+            return node;
+        std::shared_ptr<JsonNode> parent = owner->materialize();
+        node = std::make_shared<JsonNode>();
+        if (index >= 0)
+        {
+            parent->type = JsonNode::Array;
+            parent->items.resize(std::max<size_t>(parent->items.size(), index + 1));
+            for (auto &item : parent->items)
+            {
+                if (!item)
+                    item = std::make_shared<JsonNode>();
+            }
+            node = parent->items[index];
+        }
+        else
+        {
+            parent->type = JsonNode::Object;
+            parent->members.emplace_back(key, node);
+        }
+        return node;
+    }
+};
+
+typedef JsonVariant JsonObject;
+typedef JsonVariant JsonArray;
+
+class DynamicJsonDocument : public JsonVariant
+{
+public:
+    explicit DynamicJsonDocument(size_t) {}
+};
+
+template <size_t CAPACITY>
+class StaticJsonDocument : public JsonVariant
+{
+};
+
+namespace DeserializationOption
+{
+// Filters only save memory on the device; the shim keeps everything
+struct Filter
+{
+    explicit Filter(const JsonVariant &) {}
+};
+} // namespace DeserializationOption
+
+struct JsonParser
+{
+    const char *cursor;
+    const char *end;
+
+    void skipSpace()
+    {
+        while (cursor < end && isspace((unsigned char)*cursor))
+            cursor++;
+    }
+
+    bool literal(const char *word)
+    {
+        size_t length = strlen(word);
+        if ((size_t)(end - cursor) < length || strncmp(cursor, word, length) != 0)
+            return false;
+        cursor += length;
+        return true;
+    }
+
+    DeserializationError::Code parseString(std::string &out)
+    {
+        cursor++;
+        while (cursor < end && *cursor != '"')
+        {
+            char c = *cursor++;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (cursor >= end)
+                return DeserializationError::IncompleteInput;
+            char escape = *cursor++;
+            const char *from = "\"\\/bfnrt";
+            const char *to = "\"\\/\b\f\n\r\t";
+            const char *found = strchr(from, escape);
+            if (found && escape)
+            {
+                out += to[found - from];
+            }
+            else if (escape == 'u' && end - cursor >= 4)
+            {
+                unsigned long code = strtoul(std::string(cursor, 4).c_str(), nullptr, 16);
+                cursor += 4;
+                if (code < 0x80)
+                    out += (char)code;
+                else if (code < 0x800)
+                    out += std::string{(char)(0xC0 | code >> 6), (char)(0x80 | (code & 0x3F))};
+                else
+                    out += std::string{(char)(0xE0 | code >> 12), (char)(0x80 | ((code >> 6) & 0x3F)),
+                                       (char)(0x80 | (code & 0x3F))};
+            }
+            else
+            {
+                return DeserializationError::InvalidInput;
+            }
+        }
+        if (cursor >= end)
+            return DeserializationError::IncompleteInput;
+        cursor++;
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError::Code parseValue(JsonNode &node, int depth)
+    {
+        skipSpace();
+        if (cursor >= end)
+            return DeserializationError::IncompleteInput;
+        if (depth > 10)
+            return DeserializationError::InvalidInput;
+
+        DeserializationError::Code result = DeserializationError::Ok;
+        char c = *cursor;
+        if (c == '{' || c == '[')
+        {
+            bool object = c == '{';
+            node.type = object ? JsonNode::Object : JsonNode::Array;
+            cursor++;
+            skipSpace();
+            if (cursor < end && *cursor == (object ? '}' : ']'))
+            {
+                cursor++;
+                return DeserializationError::Ok;
+            }
+            for (;;)
+            {
+                std::string memberKey;
+                skipSpace();
+                if (object)
+                {
+                    if (cursor >= end)
+                        return DeserializationError::IncompleteInput;
+                    if (*cursor != '"')
+                        return DeserializationError::InvalidInput;
+                    if ((result = parseString(memberKey)) != DeserializationError::Ok)
+                        return result;
+                    skipSpace();
+                    if (cursor >= end)
+                        return DeserializationError::IncompleteInput;
+                    if (*cursor++ != ':')
+                        return DeserializationError::InvalidInput;
+                }
+                auto child = std::make_shared<JsonNode>();
+                if ((result = parseValue(*child, depth + 1)) != DeserializationError::Ok)
+                    return result;
+                if (object)
+                    node.members.emplace_back(memberKey, child);
+                else
+                    node.items.push_back(child);
+
+                skipSpace();
+                if (cursor >= end)
+                    return DeserializationError::IncompleteInput;
+                char separator = *cursor++;
+                if (separator == (object ? '}' : ']'))
+                    return DeserializationError::Ok;
+                if (separator != ',')
+                    return DeserializationError::InvalidInput;
+            }
+        }
+        if (c == '"')
+        {
+            node.type = JsonNode::Text;
+            return parseString(node.text);
+        }
+        if (literal("true") || literal("false"))
+        {
+            node.type = JsonNode::Boolean;
+            node.boolean = cursor[-2] == 'u';
+            return DeserializationError::Ok;
+        }
+        if (literal("null"))
+            return DeserializationError::Ok;
+
+        const char *start = cursor;
+        while (cursor < end && *cursor && (isdigit((unsigned char)*cursor) || strchr("+-.eE", *cursor)))
+            cursor++;
+        node.number = strtod(std::string(start, cursor).c_str(), nullptr);
+        if (cursor == start)
+            return DeserializationError::InvalidInput;
+        node.type = JsonNode::Number;
+        return DeserializationError::Ok;
+    }
+};
+
+inline DeserializationError deserializeJson(JsonVariant &document, const char *input, size_t length)
+{
+    auto root = std::make_shared<JsonNode>();
+    JsonParser parser = {input, input + length};
+    parser.skipSpace();
+    if (parser.cursor == parser.end)
+        return DeserializationError::EmptyInput;
+
+    DeserializationError::Code result = parser.parseValue(*root, 0);
+    if (result != DeserializationError::Ok)
+        return result;
+    document.node = root;
+    document.owner = nullptr;
+    return DeserializationError::Ok;
+}
+
+inline DeserializationError deserializeJson(JsonVariant &document, const String &input)
+{
+    return deserializeJson(document, input.c_str(), input.length());
+}
+
+inline DeserializationError deserializeJson(JsonVariant &document, const char *input)
+{
+    return deserializeJson(document, input, strlen(input));
+}
+
+inline DeserializationError deserializeJson(JsonVariant &document, Stream &input,
+                                            DeserializationOption::Filter = DeserializationOption::Filter(JsonVariant()))
+{
+    String text = input.readString();
+    return deserializeJson(document, text);
+}
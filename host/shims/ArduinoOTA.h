@@ -0,0 +1,32 @@
+#pragma once
+// Host shim for ArduinoOTA - no OTA server runs in the simulator
+#include <Arduino.h>
+#include <functional>
+
+typedef enum
+{
+    OTA_AUTH_ERROR,
+    OTA_BEGIN_ERROR,
+    OTA_CONNECT_ERROR,
+    OTA_RECEIVE_ERROR,
+    OTA_END_ERROR
+} ota_error_t;
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+class ArduinoOTAClass
+{
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    ArduinoOTAClass &setHostname(const char *) { return *this; }
+    ArduinoOTAClass &onStart(THandlerFunction) { return *this; }
+    ArduinoOTAClass &onEnd(THandlerFunction) { return *this; }
+    ArduinoOTAClass &onProgress(std::function<void(unsigned int, unsigned int)>) { return *this; }
+    ArduinoOTAClass &onError(std::function<void(ota_error_t)>) { return *this; }
+    void begin() {}
+    void handle() {}
+    int getCommand() { return U_FLASH; }
+};
+extern ArduinoOTAClass ArduinoOTA;
@@ -0,0 +1,42 @@
+#pragma once
+// Host shim for AsyncUDP over a UDP socket bound to hostOptions.address.
+// Packets are handled on a receive thread, like the core's UDP task.
+#include <WiFi.h>
+#include <functional>
+
+class AsyncUDPPacket
+{
+public:
+    AsyncUDPPacket(int socket, const uint8_t *data, size_t length, uint32_t remoteAddress, uint16_t remotePort)
+        : socketFd(socket), payload(data), payloadLength(length), address(remoteAddress), port(remotePort)
+    {
+    }
+    uint8_t *data() { return (uint8_t *)payload; }
+    size_t length() { return payloadLength; }
+    IPAddress remoteIP() { return IPAddress(address); }
+    uint16_t remotePort() { return port; }
+    size_t write(const uint8_t *data, size_t length);
+
+private:
+    int socketFd;
+    const uint8_t *payload;
+    size_t payloadLength;
+    uint32_t address;
+    uint16_t port;
+};
+
+class AsyncUDP
+{
+public:
+    typedef std::function<void(AsyncUDPPacket &)> PacketHandler;
+
+    bool listen(uint16_t port);
+    void close();
+    void onPacket(PacketHandler handler) { packetHandler = handler; }
+    size_t writeTo(const uint8_t *data, size_t length, const IPAddress &address, uint16_t port);
+    bool connected() { return socketFd >= 0; }
+
+private:
+    int socketFd = -1;
+    PacketHandler packetHandler;
+};
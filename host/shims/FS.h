@@ -0,0 +1,65 @@
+#pragma once
+// Host shim for the Arduino FS API, backed by a directory on the host
+// (hostOptions.fsRoot stands in for the flash partition)
+#include <Arduino.h>
+#include <memory>
+
+enum SeekMode
+{
+    SeekSet = SEEK_SET,
+    SeekCur = SEEK_CUR,
+    SeekEnd = SEEK_END
+};
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File : public Stream
+{
+public:
+    File() {}
+    explicit File(FILE *handle, const char *path);
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t *buffer, size_t size);
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void flush() override;
+    void close() { handle.reset(); }
+    operator bool() const { return handle != nullptr; }
+    const char *name() const { return path.c_str(); }
+
+private:
+    std::shared_ptr<FILE> handle;
+    String path;
+};
+
+namespace fs
+{
+class FS
+{
+public:
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, bool create = false)
+    {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    size_t totalBytes() { return 0x160000; }
+    size_t usedBytes();
+};
+} // namespace fs
+
+// Maps a flash path to its host file, creating parent directories
+std::string hostFsPath(const char *path);
@@ -0,0 +1,187 @@
+#pragma once
+// Host shim for the parts of FastLED the firmware uses. The 8-bit math is
+// FastLED's C fallback code; the controller models the WS2812B bit stream
+// time and writes each frame to the trace instead of a pin.
+#include <Arduino.h>
+
+typedef uint8_t fract8;
+
+struct CHSV
+{
+    union
+    {
+        struct
+        {
+            union
+            {
+                uint8_t hue;
+                uint8_t h;
+            };
+            union
+            {
+                uint8_t sat;
+                uint8_t s;
+            };
+            union
+            {
+                uint8_t val;
+                uint8_t v;
+            };
+        };
+        uint8_t raw[3];
+    };
+
+    CHSV() {}
+    CHSV(uint8_t hue, uint8_t sat, uint8_t val) : h(hue), s(sat), v(val) {}
+};
+
+inline uint8_t scale8(uint8_t i, fract8 scale)
+{
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+struct CRGB
+{
+    union
+    {
+        struct
+        {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        };
+        uint8_t raw[3];
+    };
+
+    enum HTMLColorCode
+    {
+        Black = 0x000000,
+        Blue = 0x0000FF,
+        Green = 0x008000,
+        Red = 0xFF0000,
+        White = 0xFFFFFF,
+        Yellow = 0xFFFF00
+    };
+
+    CRGB() {}
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    CRGB(uint32_t code) : r(code >> 16), g(code >> 8), b(code) {}
+    CRGB(HTMLColorCode code) : CRGB((uint32_t)code) {}
+
+    uint8_t &operator[](uint8_t index) { return raw[index]; }
+    const uint8_t &operator[](uint8_t index) const { return raw[index]; }
+    bool operator==(const CRGB &other) const { return r == other.r && g == other.g && b == other.b; }
+    bool operator!=(const CRGB &other) const { return !(*this == other); }
+
+    CRGB &nscale8(uint8_t scale)
+    {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+};
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac)
+{
+    if (b > a)
+        return a + scale8(b - a, frac);
+    return a - scale8(a - b, frac);
+}
+
+inline uint8_t ease8InOutQuad(uint8_t i)
+{
+    uint8_t j = i & 0x80 ? 255 - i : i;
+    uint8_t jj2 = scale8(j, j) << 1;
+    return i & 0x80 ? 255 - jj2 : jj2;
+}
+
+inline uint8_t ease8InOutCubic(fract8 i)
+{
+    uint8_t ii = scale8(i, i);
+    uint8_t iii = scale8(ii, i);
+    uint16_t r1 = (3 * (uint16_t)ii) - (2 * (uint16_t)iii);
+    return r1 & 0x100 ? 255 : r1;
+}
+
+inline uint8_t sin8(uint8_t theta)
+{
+    static const uint8_t interleave[] = {0, 49, 49, 41, 90, 27, 117, 10};
+    uint8_t offset = theta & 0x40 ? 255 - theta : theta;
+    offset &= 0x3F;
+    uint8_t secoffset = offset & 0x0F;
+    if (theta & 0x40)
+        secoffset++;
+    const uint8_t *p = interleave + (offset >> 4) * 2;
+    uint8_t mx = (p[1] * secoffset) >> 4;
+    int8_t y = mx + p[0];
+    if (theta & 0x80)
+        y = -y;
+    return y + 128;
+}
+
+inline int16_t sin16(uint16_t theta)
+{
+    static const uint16_t base[] = {0, 6393, 12539, 18204, 23170, 27245, 30273, 32137};
+    static const uint8_t slope[] = {49, 48, 44, 38, 31, 23, 14, 4};
+    uint16_t offset = (theta & 0x3FFF) >> 3;
+    if (theta & 0x4000)
+        offset = 2047 - offset;
+    uint8_t section = offset / 256;
+    uint8_t secoffset8 = (uint8_t)offset / 2;
+    int16_t y = slope[section] * secoffset8 + base[section];
+    return theta & 0x8000 ? -y : y;
+}
+
+inline int16_t cos16(uint16_t theta)
+{
+    return sin16(theta + 16384);
+}
+
+inline void fill_solid(CRGB *leds, int count, const CRGB &color)
+{
+    for (int i = 0; i < count; i++)
+        leds[i] = color;
+}
+
+template <uint8_t PIN, int ORDER>
+class WS2812B
+{
+};
+enum EOrder
+{
+    RGB = 0012,
+    GRB = 0102
+};
+
+class CLEDController
+{
+public:
+    CLEDController(CRGB *leds, int count) : pixels(leds), count(count) {}
+    void showLeds(uint8_t brightness);
+    CRGB *leds() { return pixels; }
+    int size() { return count; }
+
+private:
+    CRGB *pixels;
+    int count;
+    uint32_t frames = 0;
+};
+
+class CFastLED
+{
+public:
+    template <template <uint8_t, int> class CHIPSET, uint8_t PIN, EOrder ORDER>
+    CLEDController &addLeds(CRGB *leds, int count, int offset = 0)
+    {
+        return addController(leds + offset, count);
+    }
+    void setBrightness(uint8_t scale);
+    uint8_t getBrightness();
+    void show();
+    void show(uint8_t scale);
+
+private:
+    CLEDController &addController(CRGB *leds, int count);
+};
+extern CFastLED FastLED;
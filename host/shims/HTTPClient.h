@@ -0,0 +1,26 @@
+#pragma once
+// Host shim for HTTPClient - the simulator has no outbound network, so every
+// request fails as if the connection was refused
+#include <WiFi.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient
+{
+public:
+    bool begin(const String &) { return true; }
+    bool begin(WiFiClient &, const String &) { return true; }
+    void addHeader(const String &, const String &) {}
+    void setTimeout(uint16_t) {}
+    int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+    String getString() { return String(); }
+    int getSize() { return -1; }
+    WiFiClient &getStream() { return client; }
+    WiFiClient *getStreamPtr() { return &client; }
+    bool connected() { return false; }
+    void end() {}
+
+private:
+    WiFiClient client;
+};
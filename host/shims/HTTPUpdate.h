@@ -0,0 +1,21 @@
+#pragma once
+#include <HTTPClient.h>
+#include <functional>
+
+enum t_httpUpdate_return
+{
+    HTTP_UPDATE_FAILED,
+    HTTP_UPDATE_NO_UPDATES,
+    HTTP_UPDATE_OK
+};
+
+class HTTPUpdate
+{
+public:
+    void onStart(std::function<void()>) {}
+    void onEnd(std::function<void()>) {}
+    void onProgress(std::function<void(int, int)>) {}
+    void onError(std::function<void(int)>) {}
+    t_httpUpdate_return update(WiFiClient &, const String &) { return HTTP_UPDATE_FAILED; }
+    String getLastErrorString() { return "No network on host"; }
+};
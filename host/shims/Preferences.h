@@ -0,0 +1,29 @@
+#pragma once
+// Host shim for NVS preferences: one file per key under <fsRoot>/nvs/<namespace>/
+#include <Arduino.h>
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+    void end() {}
+    size_t putBytes(const char *key, const void *value, size_t length);
+    size_t getBytes(const char *key, void *buffer, size_t maxLength);
+    size_t getBytesLength(const char *key);
+    bool isKey(const char *key) { return getBytesLength(key) > 0; }
+    bool remove(const char *key);
+    size_t putString(const char *key, const String &value) { return putBytes(key, value.c_str(), value.length()); }
+    String getString(const char *key, const String &defaultValue = String());
+    size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, 1); }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0)
+    {
+        uint8_t value = defaultValue;
+        getBytes(key, &value, 1);
+        return value;
+    }
+
+private:
+    std::string keyPath(const char *key);
+    std::string space;
+    bool readOnly = false;
+};
@@ -0,0 +1,25 @@
+#pragma once
+// Host shim for the flash updater - there is no OTA partition, so every
+// update fails cleanly at begin()
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#ifndef U_FLASH
+#define U_FLASH 0
+#endif
+
+class UpdateClass
+{
+public:
+    bool begin(size_t = UPDATE_SIZE_UNKNOWN, int = U_FLASH) { return false; }
+    size_t write(uint8_t *, size_t) { return 0; }
+    bool end(bool = false) { return false; }
+    void abort() {}
+    bool hasError() { return true; }
+    const char *errorString() { return "No OTA partition on host"; }
+    bool isRunning() { return false; }
+    size_t progress() { return 0; }
+    size_t size() { return 0; }
+    uint8_t getError() { return 1; }
+};
+extern UpdateClass Update;
@@ -0,0 +1,111 @@
+#pragma once
+// Host shim for the ESP32 WebServer on a loopback TCP socket. Like the real
+// one it serves one request per handleClient() call from loop(), so HTTP
+// input sees the same queueing as on the device.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+enum HTTPMethod
+{
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_PATCH,
+    HTTP_DELETE,
+    HTTP_OPTIONS
+};
+
+enum HTTPUploadStatus
+{
+    UPLOAD_FILE_START,
+    UPLOAD_FILE_WRITE,
+    UPLOAD_FILE_END,
+    UPLOAD_FILE_ABORTED
+};
+
+#define HTTP_UPLOAD_BUFLEN 1436
+
+struct HTTPUpload
+{
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class WebServer
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    WebServer(int port) : port(port) {}
+    void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, nullptr); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler);
+    void begin();
+    void handleClient();
+
+    String pathArg(unsigned int index) { return index < pathArgs.size() ? pathArgs[index] : String(); }
+    String arg(const String &name);
+    bool hasArg(const String &name) { return args.count(name.c_str()) > 0; }
+    String uri() { return requestUri; }
+    HTTPMethod method() { return requestMethod; }
+    HTTPUpload &upload() { return currentUpload; }
+    String header(const String &name);
+    bool hasHeader(const String &name) { return headers.count(lower(name)) > 0; }
+
+    void send(int code, const char *contentType, const String &content);
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+    void send(int code) { send(code, "text/plain", String()); }
+    void sendHeader(const String &name, const String &value, bool first = false);
+
+    template <typename T>
+    size_t streamFile(T &file, const String &contentType, int code = 200)
+    {
+        std::string body(file.size(), '\0');
+        file.seek(0);
+        size_t length = file.read((uint8_t *)&body[0], body.size());
+        body.resize(length);
+        sendRaw(code, contentType.c_str(), body);
+        return length;
+    }
+
+private:
+    struct Route
+    {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+        THandlerFunction uploadHandler;
+    };
+
+    bool matches(const Route &route);
+    bool readRequest(int client);
+    void parseArgs(const std::string &text);
+    void deliverMultipart(const std::string &boundary, const Route *route);
+    void sendRaw(int code, const char *contentType, const std::string &body);
+    static std::string lower(const String &text);
+
+    int port;
+    int listenFd = -1;
+    int clientFd = -1;
+    uint32_t requests = 0;
+    std::vector<Route> routes;
+    HTTPMethod requestMethod = HTTP_GET;
+    String requestUri;
+    std::string requestTarget;
+    std::string body;
+    std::vector<String> pathArgs;
+    std::map<std::string, String> args;
+    std::map<std::string, String> headers;
+    std::string extraHeaders;
+    HTTPUpload currentUpload;
+};
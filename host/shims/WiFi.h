@@ -0,0 +1,71 @@
+#pragma once
+// Host shim for WiFi: the simulator is always "connected" to the loopback
+// network on hostOptions.address
+#include <Arduino.h>
+
+class IPAddress
+{
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+    explicit IPAddress(uint32_t raw) : address(raw) {}
+    String toString() const;
+    bool fromString(const char *text);
+    operator uint32_t() const { return address; }
+    bool operator==(const IPAddress &other) const { return address == other.address; }
+    uint8_t operator[](int index) const { return address >> (8 * index); }
+
+private:
+    uint32_t address; // Network byte order, like the ESP32 core
+};
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+#define WIFI_STA 1
+
+class WiFiClass
+{
+public:
+    void mode(int) {}
+    void begin(const char *, const char *) {}
+    wl_status_t status() { return WL_CONNECTED; }
+    void disconnect() {}
+    IPAddress localIP();
+    int RSSI() { return -40; }
+    void macAddress(uint8_t *mac);
+    bool setSleep(bool enabled) { return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE); }
+    bool setSleep(wifi_ps_type_t type);
+    wifi_ps_type_t getSleep() { return sleepType; }
+
+private:
+    wifi_ps_type_t sleepType = WIFI_PS_MIN_MODEM; // The core's default
+};
+extern WiFiClass WiFi;
+
+// Never connected - the simulator has no outbound network
+class WiFiClient : public Stream
+{
+public:
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int read(uint8_t *, size_t) { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t *, size_t) override { return 0; }
+    using Print::write;
+    bool connected() { return false; }
+    void stop() {}
+};
@@ -0,0 +1,381 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+HostOptions hostOptions = {nullptr, nullptr, "host_fs", "127.0.0.1", 8080, 0, 0, 30};
+HardwareSerial Serial;
+EspClass ESP;
+
+// ---- Clocks ----------------------------------------------------------------
+
+int64_t hostMonotonicNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+int64_t hostChipMicros()
+{
+    static const int64_t bootNs = hostMonotonicNs();
+    int64_t elapsedUs = (hostMonotonicNs() - bootNs) / 1000;
+    return elapsedUs + elapsedUs * hostOptions.clockPpm / 1000000 + hostOptions.clockOffsetUs;
+}
+
+int64_t esp_timer_get_time()
+{
+    return hostChipMicros();
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(uint32_t)(hostChipMicros() / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)(uint32_t)hostChipMicros();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    int64_t until = hostMonotonicNs() + (int64_t)us * 1000;
+    while (hostMonotonicNs() < until)
+    {
+    }
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)(hostChipMicros() * 240);
+}
+
+void EspClass::restart()
+{
+    hostTrace("restart", " ");
+    fprintf(stderr, "firmware_sim: ESP.restart() called, exiting\n");
+    exit(0);
+}
+
+// ---- Trace -----------------------------------------------------------------
+
+void hostTrace(const char *event, const char *format, ...)
+{
+    static std::mutex traceLock;
+    static FILE *trace = nullptr;
+    if (!hostOptions.tracePath)
+        return;
+
+    std::lock_guard<std::mutex> lock(traceLock);
+    if (!trace)
+    {
+        trace = fopen(hostOptions.tracePath, "w");
+        if (!trace)
+        {
+            hostOptions.tracePath = nullptr;
+            return;
+        }
+        setvbuf(trace, nullptr, _IOLBF, 0);
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(trace, "%lld %s ", (long long)hostMonotonicNs(), event);
+    vfprintf(trace, format, args);
+    fputc('\n', trace);
+    va_end(args);
+}
+
+// ---- GPIO and helpers ------------------------------------------------------
+
+static uint8_t pinLevels[64];
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    pinLevels[pin % 64] = value;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pinLevels[pin % 64];
+}
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh)
+{
+    return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+long random(long howBig)
+{
+    return howBig > 0 ? ::random() % howBig : 0;
+}
+
+long random(long howSmall, long howBig)
+{
+    return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+// ---- Print and Stream ------------------------------------------------------
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (written < size && write(buffer[written]))
+        written++;
+    return written;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    return write((const uint8_t *)line, std::min<size_t>(length, sizeof(line) - 1));
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+            return c;
+        delay(1);
+    } while (millis() - start < timeoutMs);
+    return -1;
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        buffer[count++] = c;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    String text;
+    for (int c = timedRead(); c >= 0; c = timedRead())
+        text += (char)c;
+    return text;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String text;
+    for (int c = timedRead(); c >= 0 && c != terminator; c = timedRead())
+        text += (char)c;
+    return text;
+}
+
+// ---- Serial over a pty -----------------------------------------------------
+// The reader thread plays the UART: bytes written by the host arrive after
+// their time on the wire, in FIFO-sized chunks, and a full RX buffer drops
+// them. Writes block like the driver with no TX buffer once more than a FIFO
+// of data is still on the wire.
+
+static const size_t UART_FIFO = 128;
+static const size_t UART_RX_CHUNK = 120; // RX FIFO full threshold
+
+static int masterFd = -1;
+static std::mutex rxLock;
+static std::deque<uint8_t> rxBuffer;
+static size_t rxCapacity = 256;
+static void (*rxCallback)() = nullptr;
+static uint32_t rxLines = 0;
+static uint32_t consumedLines = 0;
+static std::string consumedText;
+static int64_t txBusyUntilNs = 0;
+
+static int64_t byteTimeNs(unsigned long baud)
+{
+    return 10 * 1000000000LL / baud;
+}
+
+static void readerLoop(unsigned long *baud)
+{
+    int64_t wireFreeNs = 0;
+    uint8_t chunk[UART_RX_CHUNK];
+
+    for (;;)
+    {
+        pollfd request = {masterFd, POLLIN, 0};
+        if (poll(&request, 1, 100) <= 0)
+            continue;
+        ssize_t count = ::read(masterFd, chunk, sizeof(chunk));
+        if (count <= 0)
+        {
+            // No host has the pty open yet
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        int64_t arrivalNs = hostMonotonicNs();
+        wireFreeNs = std::max(wireFreeNs, arrivalNs) + count * byteTimeNs(*baud);
+        int64_t waitNs = wireFreeNs - hostMonotonicNs();
+        if (waitNs > 0)
+            std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+
+        {
+            std::lock_guard<std::mutex> lock(rxLock);
+            for (ssize_t i = 0; i < count; i++)
+            {
+                if (rxBuffer.size() >= rxCapacity)
+                {
+                    hostTrace("rx_overflow", "%d", (int)(count - i));
+                    break;
+                }
+                rxBuffer.push_back(chunk[i]);
+                if (chunk[i] == '\n')
+                    hostTrace("rx", "%u", (unsigned)++rxLines);
+            }
+        }
+        if (rxCallback)
+            rxCallback();
+    }
+}
+
+void HardwareSerial::begin(unsigned long rate)
+{
+    baud = rate;
+    if (masterFd >= 0)
+        return;
+
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0)
+    {
+        perror("firmware_sim: pty");
+        exit(1);
+    }
+
+    // Hold the slave side open in raw mode so the host end can come and go
+    const char *slavePath = ptsname(masterFd);
+    int slaveFd = open(slavePath, O_RDWR | O_NOCTTY);
+    termios settings;
+    tcgetattr(slaveFd, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slaveFd, TCSANOW, &settings);
+
+    if (hostOptions.ptyLink)
+    {
+        unlink(hostOptions.ptyLink);
+        if (symlink(slavePath, hostOptions.ptyLink) != 0)
+            perror("firmware_sim: pty link");
+    }
+    fprintf(stderr, "firmware_sim: serial on %s\n", hostOptions.ptyLink ? hostOptions.ptyLink : slavePath);
+    std::thread(readerLoop, &baud).detach();
+}
+
+void HardwareSerial::updateBaudRate(unsigned long rate)
+{
+    baud = rate;
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size)
+{
+    std::lock_guard<std::mutex> lock(rxLock);
+    rxCapacity = size;
+    return size;
+}
+
+void HardwareSerial::onReceive(void (*callback)(void), bool)
+{
+    rxCallback = callback;
+}
+
+int HardwareSerial::available()
+{
+    std::lock_guard<std::mutex> lock(rxLock);
+    return rxBuffer.size();
+}
+
+int HardwareSerial::peek()
+{
+    std::lock_guard<std::mutex> lock(rxLock);
+    return rxBuffer.empty() ? -1 : rxBuffer.front();
+}
+
+int HardwareSerial::read()
+{
+    std::lock_guard<std::mutex> lock(rxLock);
+    if (rxBuffer.empty())
+        return -1;
+    uint8_t c = rxBuffer.front();
+    rxBuffer.pop_front();
+    if (c == '\n')
+    {
+        hostTrace("line", "%u %s", (unsigned)++consumedLines, consumedText.c_str());
+        consumedText.clear();
+    }
+    else if (c >= ' ' && c < 0x7F && consumedText.size() < 256)
+    {
+        consumedText += (char)c;
+    }
+    return c;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    int64_t backlogNs = txBusyUntilNs - hostMonotonicNs();
+    if (backlogNs <= 0)
+        return UART_FIFO;
+    int64_t queued = (backlogNs + byteTimeNs(baud) - 1) / byteTimeNs(baud);
+    return queued >= (int64_t)UART_FIFO ? 0 : UART_FIFO - queued;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (masterFd < 0)
+        return size;
+
+    int64_t now = hostMonotonicNs();
+    txBusyUntilNs = std::max(txBusyUntilNs, now) + (int64_t)size * byteTimeNs(baud);
+    int64_t blockNs = txBusyUntilNs - (int64_t)UART_FIFO * byteTimeNs(baud) - now;
+    if (blockNs > 0)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(blockNs));
+
+    // Nobody reading the pty is a disconnected cable, not a stall
+    size_t written = 0;
+    while (written < size)
+    {
+        pollfd request = {masterFd, POLLOUT, 0};
+        if (poll(&request, 1, 0) <= 0)
+            break;
+        ssize_t count = ::write(masterFd, buffer + written, size - written);
+        if (count <= 0)
+            break;
+        written += count;
+    }
+    return size;
+}
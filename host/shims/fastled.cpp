@@ -0,0 +1,66 @@
+#include <FastLED.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+CFastLED FastLED;
+
+static std::vector<CLEDController *> controllers;
+static uint8_t globalBrightness = 255;
+static uint32_t globalBrightnessCalls = 0;
+
+// WS2812B latch time after the last bit
+static const uint32_t RESET_US = 50;
+
+// Sends the frame: takes as long as the bit stream would, then records what
+// would be on the strip with a hash of the scaled pixels
+void CLEDController::showLeds(uint8_t brightness)
+{
+    int64_t startNs = hostMonotonicNs();
+
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            hash = (hash ^ scale8(pixels[i].raw[c], brightness)) * 16777619u;
+    }
+
+    int64_t wireNs = ((int64_t)count * hostOptions.wireUsPerLed + RESET_US) * 1000;
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(startNs + wireNs)));
+    hostTrace("frame", "%u %u %08x %lld", (unsigned)++frames, brightness, hash, (long long)startNs);
+}
+
+CLEDController &CFastLED::addController(CRGB *leds, int count)
+{
+    controllers.push_back(new CLEDController(leds, count));
+    return *controllers.back();
+}
+
+void CFastLED::setBrightness(uint8_t scale)
+{
+    globalBrightnessCalls++;
+    globalBrightness = scale;
+}
+
+uint8_t CFastLED::getBrightness()
+{
+    globalBrightnessCalls++;
+    return globalBrightness;
+}
+
+void CFastLED::show()
+{
+    globalBrightnessCalls++;
+    show(globalBrightness);
+}
+
+uint32_t hostGlobalBrightnessCalls()
+{
+    return globalBrightnessCalls;
+}
+
+void CFastLED::show(uint8_t scale)
+{
+    for (CLEDController *controller : controllers)
+        controller->showLeds(scale);
+}
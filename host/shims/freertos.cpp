@@ -0,0 +1,132 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct HostTask
+{
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+    uint32_t stackDepth = 0;
+};
+
+struct HostSemaphore
+{
+    std::mutex lock;
+    std::condition_variable given;
+    bool available = false;
+};
+
+// Every thread that asks gets a task, including the one running loop()
+static thread_local HostTask *currentTask = nullptr;
+
+template <typename Predicate>
+static bool waitFor(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, TickType_t ticks,
+                    Predicate ready)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        condition.wait(lock, ready);
+        return true;
+    }
+    return condition.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), ready);
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void *), const char *, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t, TaskHandle_t *handle, BaseType_t)
+{
+    HostTask *created = new HostTask;
+    created->stackDepth = stackDepth;
+    if (handle)
+        *handle = created;
+
+    std::thread([task, parameter, created]() {
+        currentTask = created;
+        task(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if (!currentTask)
+        currentTask = new HostTask;
+    return currentTask;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+    HostTask *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->lock);
+    if (!waitFor(task->notified, lock, ticks, [task]() { return task->notifications > 0; }))
+        return 0;
+
+    uint32_t count = task->notifications;
+    task->notifications = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> lock(task->lock);
+        task->notifications++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+// Thread stacks are not measured on the host - report the whole stack free
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return (task ? task : xTaskGetCurrentTaskHandle())->stackDepth;
+}
+
+void portENTER_CRITICAL(portMUX_TYPE *mux)
+{
+    int unlocked = 0;
+    while (!mux->owner.compare_exchange_weak(unlocked, 1, std::memory_order_acquire))
+    {
+        unlocked = 0;
+        std::this_thread::yield();
+    }
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE *mux)
+{
+    mux->owner.store(0, std::memory_order_release);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return new HostSemaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (!waitFor(semaphore->given, lock, ticks, [semaphore]() { return semaphore->available; }))
+        return pdFALSE;
+    semaphore->available = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    {
+        std::lock_guard<std::mutex> lock(semaphore->lock);
+        if (semaphore->available)
+            return pdFALSE;
+        semaphore->available = true;
+    }
+    semaphore->given.notify_one();
+    return pdTRUE;
+}
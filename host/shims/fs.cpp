@@ -0,0 +1,187 @@
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+
+LittleFSFS LittleFS;
+
+static void makeDirectories(const std::string &path)
+{
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+        mkdir(path.substr(0, slash).c_str(), 0755);
+}
+
+std::string hostFsPath(const char *path)
+{
+    std::string full = std::string(hostOptions.fsRoot) + (path[0] == '/' ? "" : "/") + path;
+    makeDirectories(full);
+    return full;
+}
+
+// ---- File ------------------------------------------------------------------
+
+File::File(FILE *file, const char *name) : handle(file, fclose), path(name)
+{
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+    return handle ? fwrite(buffer, 1, size, handle.get()) : 0;
+}
+
+int File::available()
+{
+    return handle ? size() - position() : 0;
+}
+
+int File::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+    if (!handle)
+        return -1;
+    int c = fgetc(handle.get());
+    if (c != EOF)
+        ungetc(c, handle.get());
+    return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+    return handle ? fread(buffer, 1, size, handle.get()) : 0;
+}
+
+bool File::seek(uint32_t offset, SeekMode mode)
+{
+    return handle && fseek(handle.get(), offset, mode) == 0;
+}
+
+size_t File::position() const
+{
+    return handle ? ftell(handle.get()) : 0;
+}
+
+size_t File::size() const
+{
+    if (!handle)
+        return 0;
+    fflush(handle.get());
+    struct stat info;
+    return fstat(fileno(handle.get()), &info) == 0 ? info.st_size : 0;
+}
+
+void File::flush()
+{
+    if (handle)
+        fflush(handle.get());
+}
+
+// ---- File system -----------------------------------------------------------
+
+bool LittleFSFS::begin(bool, const char *, uint8_t, const char *)
+{
+    mkdir(hostOptions.fsRoot, 0755);
+    return access(hostOptions.fsRoot, W_OK) == 0;
+}
+
+File fs::FS::open(const char *path, const char *mode, bool)
+{
+    std::string mapped = hostFsPath(path);
+    const char *hostMode = mode[0] == 'w' ? "w+b" : mode[0] == 'a' ? "a+b" : "rb";
+    FILE *file = fopen(mapped.c_str(), hostMode);
+    return file ? File(file, path) : File();
+}
+
+bool fs::FS::exists(const char *path)
+{
+    return access(hostFsPath(path).c_str(), F_OK) == 0;
+}
+
+bool fs::FS::remove(const char *path)
+{
+    return unlink(hostFsPath(path).c_str()) == 0;
+}
+
+bool fs::FS::rename(const char *from, const char *to)
+{
+    return ::rename(hostFsPath(from).c_str(), hostFsPath(to).c_str()) == 0;
+}
+
+size_t fs::FS::usedBytes()
+{
+    size_t used = 0;
+    DIR *directory = opendir(hostOptions.fsRoot);
+    if (!directory)
+        return 0;
+    for (dirent *entry = readdir(directory); entry; entry = readdir(directory))
+    {
+        struct stat info;
+        std::string path = std::string(hostOptions.fsRoot) + "/" + entry->d_name;
+        if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            used += info.st_size;
+    }
+    closedir(directory);
+    return used;
+}
+
+// ---- Preferences -----------------------------------------------------------
+
+bool Preferences::begin(const char *name, bool openReadOnly, const char *)
+{
+    space = name;
+    readOnly = openReadOnly;
+    return true;
+}
+
+std::string Preferences::keyPath(const char *key)
+{
+    return hostFsPath(("/nvs/" + space + "/" + key).c_str());
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+    if (readOnly)
+        return 0;
+    FILE *file = fopen(keyPath(key).c_str(), "wb");
+    if (!file)
+        return 0;
+    size_t written = fwrite(value, 1, length, file);
+    fclose(file);
+    return written;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength)
+{
+    FILE *file = fopen(keyPath(key).c_str(), "rb");
+    if (!file)
+        return 0;
+    size_t count = fread(buffer, 1, maxLength, file);
+    fclose(file);
+    return count;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    struct stat info;
+    return stat(keyPath(key).c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+bool Preferences::remove(const char *key)
+{
+    return !readOnly && unlink(keyPath(key).c_str()) == 0;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue)
+{
+    size_t length = getBytesLength(key);
+    if (length == 0)
+        return defaultValue;
+    std::string value(length, '\0');
+    getBytes(key, &value[0], length);
+    return String(value);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+// Host simulation settings, filled in from the command line before setup()
+struct HostOptions
+{
+    const char *ptyLink;  // Symlink to the simulated UART's pty, if set
+    const char *tracePath;
+    const char *fsRoot;   // Directory standing in for LittleFS
+    const char *address;  // Loopback address for HTTP and UDP, e.g. 127.0.0.2
+    uint16_t httpPort;
+    int32_t clockPpm;     // Simulated crystal error
+    int64_t clockOffsetUs;
+    uint32_t wireUsPerLed; // LED bit stream time modelled by showLeds()
+};
+extern HostOptions hostOptions;
+
+// Host clock, nanoseconds on CLOCK_MONOTONIC - shared by every process on
+// the machine, so traces from several simulators line up
+int64_t hostMonotonicNs();
+
+// Local clock of the simulated chip, with the configured error applied
+int64_t hostChipMicros();
+
+// Trace lines for replay.py: "<monotonic ns> <event> <fields...>"
+void hostTrace(const char *event, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// FastLED calls that read or write the global brightness, for tests that
+// check brightness only travels with the frame
+uint32_t hostGlobalBrightnessCalls();
@@ -0,0 +1,444 @@
+#include <WiFi.h>
+#include <AsyncUDP.h>
+#include <WebServer.h>
+#include <ESPmDNS.h>
+#include <ArduinoOTA.h>
+#include <Update.h>
+#include <thread>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define TRACE_BODY_MAX 2048
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+ArduinoOTAClass ArduinoOTA;
+UpdateClass Update;
+
+// ---- WiFi ------------------------------------------------------------------
+
+String IPAddress::toString() const
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(text);
+}
+
+bool IPAddress::fromString(const char *text)
+{
+    in_addr parsed;
+    if (inet_pton(AF_INET, text, &parsed) != 1)
+        return false;
+    address = parsed.s_addr;
+    return true;
+}
+
+IPAddress WiFiClass::localIP()
+{
+    IPAddress local;
+    local.fromString(hostOptions.address);
+    return local;
+}
+
+void WiFiClass::macAddress(uint8_t *mac)
+{
+    IPAddress local = localIP();
+    const uint8_t simulated[6] = {0x02, 0x00, local[0], local[1], local[2], local[3]};
+    memcpy(mac, simulated, sizeof(simulated));
+}
+
+bool WiFiClass::setSleep(wifi_ps_type_t type)
+{
+    sleepType = type;
+    hostTrace("wifi_sleep", "%d", (int)type);
+    return true;
+}
+
+// ---- AsyncUDP --------------------------------------------------------------
+
+static sockaddr_in socketAddress(uint32_t address, uint16_t port)
+{
+    sockaddr_in socketAddress = {};
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_addr.s_addr = address;
+    socketAddress.sin_port = htons(port);
+    return socketAddress;
+}
+
+size_t AsyncUDPPacket::write(const uint8_t *data, size_t length)
+{
+    sockaddr_in to = socketAddress(address, port);
+    ssize_t sent = sendto(socketFd, data, length, 0, (sockaddr *)&to, sizeof(to));
+    return sent < 0 ? 0 : sent;
+}
+
+bool AsyncUDP::listen(uint16_t port)
+{
+    close();
+    socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sockaddr_in local = socketAddress(WiFi.localIP(), port);
+    if (socketFd < 0 || bind(socketFd, (sockaddr *)&local, sizeof(local)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    int fd = socketFd;
+    std::thread([this, fd]() {
+        uint8_t buffer[1500];
+        for (;;)
+        {
+            sockaddr_in from;
+            socklen_t fromLength = sizeof(from);
+            ssize_t length = recvfrom(fd, buffer, sizeof(buffer), 0, (sockaddr *)&from, &fromLength);
+            if (length < 0)
+                return;
+            AsyncUDPPacket packet(fd, buffer, length, from.sin_addr.s_addr, ntohs(from.sin_port));
+            if (packetHandler)
+                packetHandler(packet);
+        }
+    }).detach();
+    return true;
+}
+
+void AsyncUDP::close()
+{
+    if (socketFd >= 0)
+    {
+        shutdown(socketFd, SHUT_RDWR);
+        ::close(socketFd);
+    }
+    socketFd = -1;
+}
+
+size_t AsyncUDP::writeTo(const uint8_t *data, size_t length, const IPAddress &address, uint16_t port)
+{
+    if (socketFd < 0)
+        return 0;
+    sockaddr_in to = socketAddress(address, port);
+    ssize_t sent = sendto(socketFd, data, length, 0, (sockaddr *)&to, sizeof(to));
+    return sent < 0 ? 0 : sent;
+}
+
+// ---- WebServer -------------------------------------------------------------
+
+static const char *methodName(HTTPMethod method)
+{
+    static const char *names[] = {"ANY", "GET", "HEAD", "POST", "PUT", "PATCH", "DELETE", "OPTIONS"};
+    return names[method];
+}
+
+static std::string urlDecode(const std::string &text)
+{
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '+')
+            decoded += ' ';
+        else if (text[i] == '%' && i + 2 < text.size())
+        {
+            decoded += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        }
+        else
+            decoded += text[i];
+    }
+    return decoded;
+}
+
+std::string WebServer::lower(const String &text)
+{
+    String lowered = text;
+    lowered.toLowerCase();
+    return lowered.c_str();
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler)
+{
+    routes.push_back({uri, method, handler, uploadHandler});
+}
+
+void WebServer::begin()
+{
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Port 80 is the device's; the simulator serves on hostOptions.httpPort
+    sockaddr_in local = socketAddress(WiFi.localIP(), hostOptions.httpPort ? hostOptions.httpPort : port);
+    if (bind(listenFd, (sockaddr *)&local, sizeof(local)) != 0 || ::listen(listenFd, 8) != 0)
+    {
+        perror("firmware_sim: http");
+        ::close(listenFd);
+        listenFd = -1;
+        return;
+    }
+    fprintf(stderr, "firmware_sim: http on %s:%u\n", hostOptions.address, ntohs(local.sin_port));
+}
+
+String WebServer::arg(const String &name)
+{
+    auto found = args.find(name.c_str());
+    return found == args.end() ? String() : found->second;
+}
+
+String WebServer::header(const String &name)
+{
+    auto found = headers.find(lower(name));
+    return found == headers.end() ? String() : found->second;
+}
+
+void WebServer::parseArgs(const std::string &text)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('&', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string pair = text.substr(start, end - start);
+        size_t equals = pair.find('=');
+        if (!pair.empty())
+            args[urlDecode(pair.substr(0, equals))] = String(equals == std::string::npos ? "" : urlDecode(pair.substr(equals + 1)));
+        start = end + 1;
+    }
+}
+
+bool WebServer::readRequest(int client)
+{
+    timeval timeout = {2, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    size_t headerEnd;
+    char buffer[2048];
+    while ((headerEnd = request.find("\r\n\r\n")) == std::string::npos)
+    {
+        ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+        if (count <= 0)
+            return false;
+        request.append(buffer, count);
+    }
+
+    // Request line and headers
+    char method[16], target[1024];
+    if (sscanf(request.c_str(), "%15s %1023s", method, target) != 2)
+        return false;
+    static const HTTPMethod methods[] = {HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS};
+    requestMethod = HTTP_GET;
+    for (HTTPMethod candidate : methods)
+    {
+        if (strcmp(method, methodName(candidate)) == 0)
+            requestMethod = candidate;
+    }
+
+    headers.clear();
+    size_t lineStart = request.find("\r\n") + 2;
+    while (lineStart < headerEnd)
+    {
+        size_t lineEnd = request.find("\r\n", lineStart);
+        std::string line = request.substr(lineStart, lineEnd - lineStart);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos)
+        {
+            size_t value = line.find_first_not_of(' ', colon + 1);
+            headers[lower(String(line.substr(0, colon)))] = String(value == std::string::npos ? "" : line.substr(value));
+        }
+        lineStart = lineEnd + 2;
+    }
+
+    // Body
+    size_t length = header("Content-Length").toInt();
+    body = request.substr(headerEnd + 4);
+    while (body.size() < length)
+    {
+        ssize_t count = recv(client, buffer, std::min(sizeof(buffer), length - body.size()), 0);
+        if (count <= 0)
+            return false;
+        body.append(buffer, count);
+    }
+    body.resize(length);
+
+    // Arguments from the query string and the body, "plain" for raw bodies
+    args.clear();
+    std::string path = target;
+    size_t query = path.find('?');
+    if (query != std::string::npos)
+    {
+        parseArgs(path.substr(query + 1));
+        path.resize(query);
+    }
+    requestUri = String(urlDecode(path));
+    requestTarget = target;
+
+    String contentType = header("Content-Type");
+    if (contentType.startsWith("application/x-www-form-urlencoded"))
+        parseArgs(body);
+    else if (!contentType.startsWith("multipart/form-data") && !body.empty())
+        args["plain"] = String(body);
+    return true;
+}
+
+bool WebServer::matches(const Route &route)
+{
+    if (route.method != HTTP_ANY && route.method != requestMethod)
+        return false;
+
+    pathArgs.clear();
+    if (route.uri.endsWith("/*"))
+    {
+        String prefix = route.uri.substring(0, route.uri.length() - 1);
+        if (!requestUri.startsWith(prefix))
+            return false;
+        pathArgs.push_back(requestUri.substring(prefix.length()));
+        return true;
+    }
+    return route.uri == requestUri;
+}
+
+// Splits a multipart body: file parts go through the upload handler in
+// HTTP_UPLOAD_BUFLEN pieces, other fields become arguments
+void WebServer::deliverMultipart(const std::string &boundary, const Route *route)
+{
+    std::string delimiter = "--" + boundary;
+    size_t part = body.find(delimiter);
+    while (part != std::string::npos)
+    {
+        size_t headersStart = part + delimiter.size() + 2;
+        size_t headersEnd = body.find("\r\n\r\n", headersStart);
+        size_t next = body.find("\r\n" + delimiter, headersEnd);
+        if (headersEnd == std::string::npos || next == std::string::npos)
+            return;
+
+        std::string partHeaders = body.substr(headersStart, headersEnd - headersStart);
+        std::string content = body.substr(headersEnd + 4, next - headersEnd - 4);
+        auto field = [&partHeaders](const char *key) {
+            size_t at = partHeaders.find(std::string(key) + "=\"");
+            if (at == std::string::npos)
+                return std::string();
+            at += strlen(key) + 2;
+            return partHeaders.substr(at, partHeaders.find('"', at) - at);
+        };
+
+        std::string filename = field("filename");
+        if (filename.empty())
+        {
+            args[field("name")] = String(content);
+        }
+        else if (route && route->uploadHandler)
+        {
+            currentUpload.filename = String(filename);
+            currentUpload.name = String(field("name"));
+            currentUpload.totalSize = 0;
+            currentUpload.currentSize = 0;
+            currentUpload.status = UPLOAD_FILE_START;
+            route->uploadHandler();
+
+            currentUpload.status = UPLOAD_FILE_WRITE;
+            for (size_t offset = 0; offset < content.size(); offset += HTTP_UPLOAD_BUFLEN)
+            {
+                currentUpload.currentSize = std::min<size_t>(HTTP_UPLOAD_BUFLEN, content.size() - offset);
+                memcpy(currentUpload.buf, content.data() + offset, currentUpload.currentSize);
+                currentUpload.totalSize += currentUpload.currentSize;
+                route->uploadHandler();
+            }
+
+            currentUpload.status = UPLOAD_FILE_END;
+            currentUpload.currentSize = 0;
+            route->uploadHandler();
+        }
+        part = next + 2;
+        if (body.compare(part + delimiter.size(), 2, "--") == 0)
+            return;
+    }
+}
+
+// Percent-encoded so the trace stays one line per event; uploads are elided
+static std::string traceBody(const std::string &body)
+{
+    if (body.size() > TRACE_BODY_MAX)
+        return "-";
+    std::string encoded;
+    for (unsigned char c : body)
+    {
+        char escape[4];
+        snprintf(escape, sizeof(escape), "%%%02X", c);
+        encoded += c > ' ' && c < 0x7F && c != '%' ? std::string(1, (char)c) : std::string(escape);
+    }
+    return encoded;
+}
+
+void WebServer::handleClient()
+{
+    if (listenFd < 0)
+        return;
+    int client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0)
+        return;
+
+    if (readRequest(client))
+    {
+        clientFd = client;
+        uint32_t request = ++requests;
+        hostTrace("http", "%u %s %s %s", (unsigned)request, methodName(requestMethod), requestTarget.c_str(),
+                  traceBody(body).c_str());
+
+        const Route *route = nullptr;
+        for (const Route &candidate : routes)
+        {
+            if (matches(candidate))
+            {
+                route = &candidate;
+                break;
+            }
+        }
+
+        String contentType = header("Content-Type");
+        int boundary = contentType.indexOf("boundary=");
+        if (contentType.startsWith("multipart/form-data") && boundary >= 0)
+            deliverMultipart(contentType.substring(boundary + 9).c_str(), route);
+
+        if (route)
+            route->handler();
+        else
+            send(404, "text/plain", "Not found: " + requestUri);
+    }
+    clientFd = -1;
+    extraHeaders.clear();
+    ::close(client);
+}
+
+void WebServer::sendHeader(const String &name, const String &value, bool)
+{
+    extraHeaders += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+}
+
+void WebServer::send(int code, const char *contentType, const String &content)
+{
+    sendRaw(code, contentType, std::string(content.c_str(), content.length()));
+}
+
+void WebServer::sendRaw(int code, const char *contentType, const std::string &content)
+{
+    if (clientFd < 0)
+        return;
+
+    char head[256];
+    const char *reason = code == 200 ? "OK" : code == 400 ? "Bad Request" : code == 404 ? "Not Found" :
+                         code == 405 ? "Method Not Allowed" : "Error";
+    snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n",
+             code, reason, contentType, (unsigned)content.size());
+    std::string response = head + extraHeaders + "\r\n" + content;
+    for (size_t sent = 0; sent < response.size();)
+    {
+        ssize_t count = ::send(clientFd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0)
+            break;
+        sent += count;
+    }
+    hostTrace("http_done", "%u %d", (unsigned)requests, code);
+    clientFd = -1;
+}
@@ -0,0 +1,4 @@
+#pragma once
+// The simulator never joins a real network
+const char *WIFI_SSID = "host";
+const char *WIFI_PASSWORD = "";
@@ -0,0 +1,73 @@
+// Host simulation of the firmware: runs setup() and loop() from src/main.cpp
+// against the shims in shims/. See HOST_SIMULATION_GUIDE.md.
+#include <Arduino.h>
+#include <getopt.h>
+
+void setup();
+void loop();
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: firmware_sim [options]\n"
+            "  --pty PATH          symlink to the serial pty\n"
+            "  --trace PATH        write input and frame events here\n"
+            "  --fs DIR            directory standing in for LittleFS (default host_fs)\n"
+            "  --address IP        loopback address for HTTP and UDP (default 127.0.0.1)\n"
+            "  --http-port N       HTTP port (default 8080)\n"
+            "  --clock-ppm N       chip clock error in ppm\n"
+            "  --clock-offset-us N chip clock offset at boot\n"
+            "  --wire-us N         LED bit stream time per LED (default 30)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static const option options[] = {{"pty", required_argument, nullptr, 'p'},
+                                     {"trace", required_argument, nullptr, 't'},
+                                     {"fs", required_argument, nullptr, 'f'},
+                                     {"address", required_argument, nullptr, 'a'},
+                                     {"http-port", required_argument, nullptr, 'h'},
+                                     {"clock-ppm", required_argument, nullptr, 'c'},
+                                     {"clock-offset-us", required_argument, nullptr, 'o'},
+                                     {"wire-us", required_argument, nullptr, 'w'},
+                                     {nullptr, 0, nullptr, 0}};
+
+    for (int option; (option = getopt_long(argc, argv, "", options, nullptr)) != -1;)
+    {
+        switch (option)
+        {
+        case 'p':
+            hostOptions.ptyLink = optarg;
+            break;
+        case 't':
+            hostOptions.tracePath = optarg;
+            break;
+        case 'f':
+            hostOptions.fsRoot = optarg;
+            break;
+        case 'a':
+            hostOptions.address = optarg;
+            break;
+        case 'h':
+            hostOptions.httpPort = atoi(optarg);
+            break;
+        case 'c':
+            hostOptions.clockPpm = atoi(optarg);
+            break;
+        case 'o':
+            hostOptions.clockOffsetUs = atoll(optarg);
+            break;
+        case 'w':
+            hostOptions.wireUsPerLed = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    setup();
+    hostTrace("ready", " ");
+    for (;;)
+        loop();
+}
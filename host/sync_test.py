@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Multi-process clock sync test: a master and two UDP slaves with skewed
+crystals on loopback, plus a unit following this script over serial.
+Every unit's shared clock is read with time:us and compared on the host
+clock. See HOST_SIMULATION_GUIDE.md."""
+
+import argparse
+import os
+import queue
+import select
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import tty
+
+BAUD = 115200
+SERIAL_MASTER_OFFSET_US = 7_000_000_000  # Serial master's clock = host clock + this
+
+# address, clock error in ppm, clock offset at boot in us, role
+UNITS = [
+    ("127.0.0.2", 0, 3_000_000, "master"),
+    ("127.0.0.3", 60, 9_000_000, "slave"),
+    ("127.0.0.4", -45, 1_000_000, "slave"),
+    ("127.0.0.5", 35, 4_000_000, "serial"),
+]
+
+
+def host_us():
+    return time.clock_gettime_ns(time.CLOCK_MONOTONIC) // 1000
+
+
+def wire_us(length):
+    return length * 10 * 1_000_000 // BAUD
+
+
+class Unit:
+    def __init__(self, binary, workdir, address, ppm, offset, role):
+        self.address = address
+        self.role = role
+        self.replies = queue.Queue()
+        pty_path = os.path.join(workdir, address + ".pty")
+        trace_path = os.path.join(workdir, address + ".trace")
+        self.process = subprocess.Popen(
+            [binary, "--pty", pty_path, "--trace", trace_path, "--fs", os.path.join(workdir, address),
+             "--address", address, "--http-port", "18100", "--clock-ppm", str(ppm),
+             "--clock-offset-us", str(offset)], stderr=subprocess.DEVNULL)
+
+        deadline = time.monotonic() + 10
+        while not (os.path.exists(trace_path) and " ready " in open(trace_path).read()):
+            if time.monotonic() > deadline or self.process.poll() is not None:
+                sys.exit(f"{address}: firmware_sim did not come up")
+            time.sleep(0.05)
+        self.serial = os.open(pty_path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.serial)
+        threading.Thread(target=self.read_lines, daemon=True).start()
+
+    def send(self, line):
+        os.write(self.serial, line.encode() + b"\n")
+
+    def read_lines(self):
+        pending = b""
+        while True:
+            select.select([self.serial], [], [])
+            try:
+                pending += os.read(self.serial, 4096)
+            except OSError:
+                return
+            while b"\n" in pending:
+                line, pending = pending.split(b"\n", 1)
+                received = host_us()
+                text = line.decode(errors="replace").strip()
+                if text.startswith("RESPONSE:SYNC_REQ "):
+                    # Answer as a serial master whose clock runs on the host's
+                    t1 = received + SERIAL_MASTER_OFFSET_US
+                    self.send(f"sync:{text.split()[1]},{t1},{host_us() + SERIAL_MASTER_OFFSET_US}")
+                elif text.startswith("RESPONSE:"):
+                    self.replies.put((received, text[len("RESPONSE:"):]))
+
+    def command(self, line, prefix, timeout=2):
+        sent = host_us()
+        self.send(line)
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            try:
+                received, text = self.replies.get(timeout=0.1)
+            except queue.Empty:
+                continue
+            if text.startswith(prefix):
+                return sent, received, text
+        sys.exit(f"{self.address}: no reply to {line}")
+
+    def clock_offset_us(self, samples=15):
+        """Shared clock minus host clock, from the quickest time:us exchange"""
+        best = None
+        for _ in range(samples):
+            sent, received, text = self.command("time:us", "TIME_US ")
+            synced = int(text.split()[1])
+            # Midpoint between the request arriving and the reply leaving
+            arrived = sent + wire_us(len("time:us\n"))
+            left = received - wire_us(len("RESPONSE:" + text + "\n"))
+            round_trip = received - sent
+            if best is None or round_trip < best[0]:
+                best = (round_trip, synced - (arrived + left) // 2)
+            time.sleep(0.02)
+        return best[1]
+
+    def stop(self):
+        self.process.terminate()
+        self.process.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--sim", default=os.path.join(os.path.dirname(__file__), "build", "firmware_sim"))
+    parser.add_argument("--settle", type=float, default=12.0, help="seconds of sync before measuring")
+    parser.add_argument("--udp-limit-us", type=int, default=1000, help="allowed slave error")
+    parser.add_argument("--serial-limit-us", type=int, default=2000, help="allowed serial follower error")
+    arguments = parser.parse_args()
+
+    with tempfile.TemporaryDirectory(prefix="sync_test_") as workdir:
+        units = [Unit(arguments.sim, workdir, *unit) for unit in UNITS]
+        try:
+            master = units[0]
+            for unit in units:
+                if unit.role == "master":
+                    unit.command("sync:master", "Time sync master")
+                elif unit.role == "slave":
+                    unit.command(f"sync:slave:{master.address}", "Time sync slave")
+                else:
+                    unit.command("sync:serial", "Time sync over serial")
+
+            before = {unit.address: unit.clock_offset_us() for unit in units}
+            time.sleep(arguments.settle)
+            after = {unit.address: unit.clock_offset_us() for unit in units}
+            status = {unit.address: unit.command("sync:status", "Sync ")[2] for unit in units}
+        finally:
+            for unit in units:
+                unit.stop()
+
+    failed = False
+    for unit in units:
+        if unit.role == "master":
+            reference, limit = after[master.address], None
+        elif unit.role == "slave":
+            reference, limit = after[master.address], arguments.udp_limit_us
+        else:
+            reference, limit = SERIAL_MASTER_OFFSET_US, arguments.serial_limit_us
+        error = after[unit.address] - reference
+        verdict = "" if limit is None else ("ok" if abs(error) <= limit else "FAIL")
+        failed |= verdict == "FAIL"
+        print(f"{unit.address} {unit.role:>6}: error {error:+d} us (at start {before[unit.address] - reference:+d}) "
+              f"{verdict}  [{status[unit.address]}]")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
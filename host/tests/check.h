@@ -0,0 +1,27 @@
+#pragma once
+#include <stdio.h>
+
+// Shared by the host tests: CHECK() records a failure and carries on, and
+// main() ends with `return checkResult("name_test");`
+static int failures = 0;
+
+#define CHECK(condition)                                                  \
+    do                                                                    \
+    {                                                                     \
+        if (!(condition))                                                 \
+        {                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+static int checkResult(const char *test)
+{
+    if (failures)
+    {
+        fprintf(stderr, "%s: %d failed\n", test, failures);
+        return 1;
+    }
+    printf("%s: ok\n", test);
+    return 0;
+}
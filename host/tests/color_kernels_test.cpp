@@ -0,0 +1,193 @@
+// Color kernels: every SWAR kernel must write the same bytes as its scalar
+// version for every scale and amount, at every buffer alignment. Then both
+// versions are timed with the same benchmark kernels:bench runs on the device.
+#include <Arduino.h>
+#include "color_kernels.h"
+#include "check.h"
+
+static const uint16_t PIXELS = 300;
+
+// Pixel set: every byte value in every channel, then pseudo-random pixels
+static CRGB pixelSet[PIXELS + 3];
+static CRGB otherSet[PIXELS + 3];
+
+static void fillPixelSets()
+{
+    uint32_t seed = 0x9E3779B9;
+    for (uint16_t i = 0; i < PIXELS + 3; i++)
+    {
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            pixelSet[i].raw[c] = i < 256 ? i : seed >> 24;
+            otherSet[i].raw[c] = i < 256 ? 255 - i + c * 85 : seed >> 16;
+        }
+    }
+}
+
+static bool sameBytes(const CRGB *a, const CRGB *b, uint16_t count)
+{
+    return memcmp(a, b, count * sizeof(CRGB)) == 0;
+}
+
+static void testHsvToRgb()
+{
+    // All 2^24 colors, one span of every hue per saturation and value
+    CHSV in[256];
+    CRGB scalar[256];
+    CRGB swar[256];
+    int mismatches = 0;
+    for (uint16_t sat = 0; sat < 256; sat++)
+    {
+        for (uint16_t val = 0; val < 256; val++)
+        {
+            for (uint16_t hue = 0; hue < 256; hue++)
+                in[hue] = CHSV(hue, sat, val);
+            hsvToRgbSpanScalar(in, scalar, 256);
+            hsvToRgbSpanSwar(in, swar, 256);
+            mismatches += !sameBytes(scalar, swar, 256);
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+static void testRainbow()
+{
+    CRGB scalar[256];
+    CRGB swar[256];
+    int mismatches = 0;
+    for (uint16_t sat = 0; sat < 256; sat++)
+    {
+        for (uint16_t val = 0; val < 256; val++)
+        {
+            rainbowSpanScalar(scalar, 256, 0, 1, sat, val);
+            rainbowSpanSwar(swar, 256, 0, 1, sat, val);
+            mismatches += !sameBytes(scalar, swar, 256);
+
+            rainbowSpanScalar(scalar, 100, 17, 3, sat, val);
+            rainbowSpanSwar(swar, 100, 17, 3, sat, val);
+            mismatches += !sameBytes(scalar, swar, 100);
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// Spans starting 0-3 pixels in cover every byte alignment of a 32-bit word
+static void testScale()
+{
+    CRGB scalar[PIXELS + 3];
+    CRGB swar[PIXELS + 3];
+    int mismatches = 0;
+    for (uint16_t scale = 0; scale < 256; scale++)
+    {
+        for (uint8_t start = 0; start < 4; start++)
+        {
+            memcpy(scalar, pixelSet, sizeof(pixelSet));
+            memcpy(swar, pixelSet, sizeof(pixelSet));
+            scaleSpanScalar(scalar + start, PIXELS - start, scale);
+            scaleSpanSwar(swar + start, PIXELS - start, scale);
+            mismatches += !sameBytes(scalar, swar, PIXELS + 3);
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+static void testBlend()
+{
+    CRGB scalar[PIXELS + 3];
+    CRGB swar[PIXELS + 3];
+    int mismatches = 0;
+    for (uint16_t amount = 0; amount < 256; amount++)
+    {
+        for (uint8_t start = 0; start < 4; start++)
+        {
+            // Output aligned with both inputs, and with neither
+            for (uint8_t shift = 0; shift < 2; shift++)
+            {
+                memset(scalar, 0, sizeof(scalar));
+                memset(swar, 0, sizeof(swar));
+                uint16_t count = PIXELS - 1 - start;
+                blendSpanScalar(pixelSet + start, otherSet + start, scalar + start + shift, count, amount);
+                blendSpanSwar(pixelSet + start, otherSet + start, swar + start + shift, count, amount);
+                mismatches += !sameBytes(scalar, swar, PIXELS + 3);
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // In place, as transitions blend into leds[]
+    memcpy(scalar, pixelSet, sizeof(pixelSet));
+    memcpy(swar, pixelSet, sizeof(pixelSet));
+    blendSpanScalar(scalar, otherSet, scalar, PIXELS, 91);
+    blendSpanSwar(swar, otherSet, swar, PIXELS, 91);
+    CHECK(sameBytes(scalar, swar, PIXELS));
+}
+
+static void testAdd()
+{
+    // Every pair of byte values: a's bytes count up and b's step every 256
+    static CRGB a[256 * 256 / 3 + 1];
+    static CRGB b[256 * 256 / 3 + 1];
+    static CRGB scalar[256 * 256 / 3 + 1];
+    uint16_t count = sizeof(a) / sizeof(CRGB);
+    uint8_t *aBytes = a->raw;
+    uint8_t *bBytes = b->raw;
+    for (uint32_t i = 0; i < count * 3u; i++)
+    {
+        aBytes[i] = i;
+        bBytes[i] = i >> 8;
+    }
+    memcpy(scalar, a, sizeof(a));
+    addSpanScalar(scalar, b, count);
+    addSpanSwar(a, b, count);
+    CHECK(sameBytes(scalar, a, count));
+
+    const uint8_t *sums = scalar->raw;
+    int wrong = 0;
+    for (uint32_t i = 0; i < count * 3u; i++)
+        wrong += sums[i] != min(255u, (i & 0xFF) + ((i >> 8) & 0xFF));
+    CHECK(wrong == 0);
+
+    // Unaligned spans
+    CRGB scalarSpan[PIXELS + 3];
+    CRGB swarSpan[PIXELS + 3];
+    for (uint8_t start = 0; start < 4; start++)
+    {
+        for (uint8_t shift = 0; shift < 2; shift++)
+        {
+            memcpy(scalarSpan, pixelSet, sizeof(pixelSet));
+            memcpy(swarSpan, pixelSet, sizeof(pixelSet));
+            addSpanScalar(scalarSpan + start, otherSet + start + shift, PIXELS - 1 - start);
+            addSpanSwar(swarSpan + start, otherSet + start + shift, PIXELS - 1 - start);
+            CHECK(sameBytes(scalarSpan, swarSpan, PIXELS + 3));
+        }
+    }
+}
+
+static void testBenchmark()
+{
+    KernelBenchResult results[COLOR_KERNEL_COUNT];
+    uint8_t count = benchmarkColorKernels(results);
+    CHECK(count == COLOR_KERNEL_COUNT);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        printf("  %-8s scalar %4u ns/pixel, swar %4u ns/pixel\n", results[i].name,
+               (unsigned)results[i].scalarNs, (unsigned)results[i].swarNs);
+        CHECK(results[i].exact);
+    }
+}
+
+int main()
+{
+    initializeColorKernels();
+    fillPixelSets();
+
+    testHsvToRgb();
+    testRainbow();
+    testScale();
+    testBlend();
+    testAdd();
+    testBenchmark();
+
+    return checkResult("color_kernels_test");
+}
@@ -0,0 +1,55 @@
+// Effect VM on the host: arithmetic edge cases a user program can reach must
+// not crash, and a compiled program is timed against the native effects.
+#include <Arduino.h>
+#include "color_kernels.h"
+#include "effect_vm.h"
+#include "pixel_map.h"
+#include "check.h"
+
+static bool compileProgram(const char *source)
+{
+    char error[48];
+    if (vmCompile(source, vmProgram, error, sizeof(error)))
+        return true;
+    fprintf(stderr, "%s: %s\n", source, error);
+    return false;
+}
+
+static void testModuloOverflow()
+{
+    // -32768 is INT32_MIN in 16.16 and 2^-16 is -1, the one pair that
+    // overflows a % b. The result is 0, so v is 0 and every pixel is black.
+    CHECK(compileProgram("h=x v=(-32767-1)%(-0.0000152587890625)"));
+    CRGB out[LED_BUFFER_SIZE];
+    memset(out, 0xFF, sizeof(out));
+    MusicFrame music = {};
+    vmRenderEffect(out, 0, music, 0);
+    int lit = 0;
+    for (int i = 0; i < NUM_LEDS; i++)
+        lit += out[i] != CRGB(CRGB::Black);
+    CHECK(lit == 0);
+
+    CHECK(compileProgram("h=x v=(-32767-1)/(-0.0000152587890625)"));
+    vmRenderEffect(out, 0, music, 0);
+}
+
+static void testBenchmark()
+{
+    // A hue sweep with a sine wave lifted by the beat
+    CHECK(compileProgram("h=x+t*0.2 s=1 v=clamp(0.5+0.5*sin(x*3-t)+beat)"));
+    uint32_t vmNs, rainbowNs, visualizerNs;
+    vmBenchmark(vmNs, rainbowNs, visualizerNs);
+    printf("  %u instructions: vm %u ns/pixel, rainbow %u ns/pixel, visualizer %u ns/pixel\n",
+           vmProgram.length, (unsigned)vmNs, (unsigned)rainbowNs, (unsigned)visualizerNs);
+    CHECK(vmProgram.length <= VM_INSTRUCTION_LIMIT);
+}
+
+int main()
+{
+    initializeColorKernels();
+
+    testModuloOverflow();
+    testBenchmark();
+
+    return checkResult("effect_vm_test");
+}
@@ -0,0 +1,137 @@
+// Golden-frame capture on the host: a fixed show is rendered under the
+// simulated clock and diffed, bit for bit, against host/golden/show.lcp.
+// After an intended change to the render path, refresh the golden file with
+//   build/tests/golden_capture_test --update
+// and commit it with the change.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "effect_vm.h"
+#include "frame_capture.h"
+#include "input_mailbox.h"
+#include "led_control.h"
+#include "led_output.h"
+#include "mock_led_driver.h"
+#include "check.h"
+
+static const char *GOLDEN_NAME = "show";
+static const uint32_t SHOW_FRAMES = 240;
+
+// Copies a file between the host file system and the LittleFS root
+static bool copyFile(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb");
+    FILE *out = in ? fopen(to, "wb") : nullptr;
+    bool ok = in && out;
+    char chunk[4096];
+    size_t got;
+    while (ok && (got = fread(chunk, 1, sizeof(chunk), in)) > 0)
+        ok = fwrite(chunk, 1, got, out) == got;
+    if (in)
+        fclose(in);
+    if (out)
+        fclose(out);
+    return ok;
+}
+
+static void renderFrame()
+{
+    uint32_t target = captureFrameCount + 1;
+    uint32_t start = millis();
+    while (captureActive && captureFrameCount < target && millis() - start < 1000)
+    {
+        handleLedStrip();
+        delay(1);
+    }
+}
+
+// Music input on a fixed frame pattern: a beat every 12 frames, bands that
+// rise and fall with the frame index
+static void postMusic(uint32_t frame)
+{
+    MusicFrame music = {};
+    music.beat = frame % 12 == 0 ? 90 : 10;
+    music.bandCount = MUSIC_BANDS;
+    for (uint8_t band = 0; band < MUSIC_BANDS; band++)
+        music.bands[band] = (frame * 7 + band * 23) % 100;
+    postMusicFrame(music);
+}
+
+// Each effect, with crossfades between them, staged on fixed capture frames
+static void playShow()
+{
+    char error[48];
+    for (uint32_t frame = 0; captureActive; frame++)
+    {
+        switch (frame)
+        {
+        case 40:
+            transitionDurationMs = 200;
+            stageMode(MODE_VISUALIZER);
+            break;
+        case 80:
+            stageMode(MODE_SPECTRUM);
+            break;
+        case 120:
+            stageMode(MODE_SOLID);
+            stageColor(CRGB(255, 80, 0));
+            stageBrightness(100);
+            break;
+        case 160:
+            CHECK(vmLoadProgram("h=x+t*0.2 v=0.5+0.5*sin(x*2-t)", error, sizeof(error)));
+            stageMode(MODE_VM);
+            break;
+        case 200:
+            stageBrightness(200);
+            stageMode(MODE_RAINBOW_2D);
+            break;
+        }
+        if (frame >= 40 && frame < 120 && frame % 3 == 0)
+            postMusic(frame);
+        renderFrame();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+    char goldenFile[64];
+    snprintf(goldenFile, sizeof(goldenFile), "golden/%s.lcp", GOLDEN_NAME);
+
+    char root[] = "/tmp/golden_capture_testXXXXXX";
+    hostOptions.fsRoot = mkdtemp(root);
+    LittleFS.begin(true);
+    initializeLEDs();
+    CHECK(setLedDriver(&mockLedDriver));
+
+    // Start from a known state with no transition running
+    transitionDurationMs = 0;
+    stageMode(MODE_RAINBOW);
+    stageBrightness(BRIGHTNESS);
+    handleLedStrip();
+
+    CHECK(captureStart(SHOW_FRAMES));
+    playShow();
+    CHECK(captureFrameCount == SHOW_FRAMES);
+
+    String capture = String(hostOptions.fsRoot) + CAPTURE_PATH;
+    if (update)
+    {
+        CHECK(copyFile(capture.c_str(), goldenFile));
+        printf("golden_capture_test: wrote %s\n", goldenFile);
+        return checkResult("golden_capture_test");
+    }
+
+    String golden = String(hostOptions.fsRoot) + CAPTURE_GOLDEN_PREFIX + GOLDEN_NAME + ".lcp";
+    CHECK(copyFile(goldenFile, golden.c_str()));
+
+    CaptureComparison result;
+    CHECK(captureCompare(GOLDEN_NAME, 0, result));
+    if (result.mismatchedFrames || result.lengthMismatch)
+        fprintf(stderr, "golden_capture_test: %u of %u frames differ, first frame %u pixel %u, max diff %u%s\n",
+                (unsigned)result.mismatchedFrames, (unsigned)result.frames, (unsigned)result.firstFrame,
+                result.firstPixel, result.maxDiff, result.lengthMismatch ? ", lengths differ" : "");
+    CHECK(result.frames == SHOW_FRAMES);
+    CHECK(result.mismatchedFrames == 0 && !result.lengthMismatch);
+
+    return checkResult("golden_capture_test");
+}
@@ -0,0 +1,109 @@
+// Render loop against the mock LED driver: brightness must travel with each
+// frame, and FastLED's global brightness must never be used, since the async
+// driver's output task reads the controller while loop() renders.
+#include <Arduino.h>
+#include "led_control.h"
+#include "led_output.h"
+#include "mock_led_driver.h"
+#include "check.h"
+
+// Runs the render loop in real time until it has pushed `frames` more
+// frames or the strip goes idle for a second
+static void renderFrames(size_t frames)
+{
+    size_t target = mockFrames.size() + frames;
+    uint32_t idleSince = millis();
+    size_t seen = mockFrames.size();
+    while (mockFrames.size() < target && millis() - idleSince < 1000)
+    {
+        handleLedStrip();
+        if (mockFrames.size() != seen)
+        {
+            seen = mockFrames.size();
+            idleSince = millis();
+        }
+        delay(1);
+    }
+}
+
+static void testTransitionBrightness()
+{
+    stageMode(MODE_SOLID);
+    stageColor(CRGB::White);
+    stageBrightness(40);
+    transitionDurationMs = 0;
+    renderFrames(1);
+    CHECK(!mockFrames.empty() && mockFrames.back().brightness == 40);
+
+    // A linear 200 ms fade to 200 climbs every frame and lands exactly
+    resetMockLedDriver();
+    transitionDurationMs = 200;
+    transitionEasing = EASE_LINEAR;
+    stageBrightness(200);
+    renderFrames(200 / FRAME_INTERVAL_MS + 5);
+
+    CHECK(mockFrames.size() >= 200 / FRAME_INTERVAL_MS);
+    CHECK(mockFrames.back().brightness == 200);
+    int intermediate = 0;
+    for (size_t i = 1; i < mockFrames.size(); i++)
+    {
+        CHECK(mockFrames[i].brightness >= mockFrames[i - 1].brightness);
+        intermediate += mockFrames[i].brightness > 40 && mockFrames[i].brightness < 200;
+    }
+    CHECK(intermediate >= (int)(200 / FRAME_INTERVAL_MS) / 2);
+
+    // Retargeting mid-fade continues from the brightness on the strip
+    resetMockLedDriver();
+    stageBrightness(40);
+    renderFrames(5);
+    uint8_t midFade = mockFrames.back().brightness;
+    stageBrightness(255);
+    renderFrames(1);
+    CHECK(abs((int)mockFrames.back().brightness - midFade) < 40);
+    renderFrames(200 / FRAME_INTERVAL_MS + 5);
+    CHECK(mockFrames.back().brightness == 255);
+}
+
+static void testFrameIsCopied()
+{
+    // The renderer draws the next frame into leds[] while the driver holds
+    // the last one, so a submitted frame must not change afterwards
+    resetMockLedDriver();
+    transitionDurationMs = 0;
+    stageMode(MODE_RAINBOW);
+    renderFrames(2);
+    CHECK(mockFrames.size() == 2);
+    CHECK(mockFrames.size() == 2 && mockFrames[0].pixels != mockFrames[1].pixels);
+}
+
+static void testAsyncDriver()
+{
+    // The real async driver, on the shim's output task and controller
+    CHECK(setLedDriver(&asyncLedDriver));
+    uint32_t sent = ledOutputStats.frames;
+    stageBrightness(90);
+    uint32_t start = millis();
+    while (ledOutputStats.frames < sent + 5 && millis() - start < 1000)
+    {
+        handleLedStrip();
+        delay(1);
+    }
+    ledDriver->waitIdle();
+    CHECK(ledOutputStats.frames >= sent + 5);
+    CHECK(setLedDriver(&mockLedDriver));
+}
+
+int main()
+{
+    initializeLEDs();
+    CHECK(setLedDriver(&mockLedDriver));
+    setSimulatedClock(true);
+
+    testTransitionBrightness();
+    testFrameIsCopied();
+    testAsyncDriver();
+
+    CHECK(hostGlobalBrightnessCalls() == 0);
+
+    return checkResult("led_output_test");
+}
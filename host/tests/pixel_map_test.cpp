@@ -0,0 +1,67 @@
+// Pixel maps on the host: tall grids in the spectrum effect, and a new map
+// being built beside the active one rather than over it.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "color_kernels.h"
+#include "led_control.h"
+#include "pixel_map.h"
+#include "check.h"
+
+static void testSpectrumOnTallGrid()
+{
+    // 5 x 200 cells: every LED sits in the top 12 rows, which a full-scale
+    // beat lights. Column levels reach 200 * 256 there.
+    CHECK(buildMatrixPixelMap({5, 200, false, 0}));
+    CHECK(mapHeight == 200);
+
+    MusicFrame music = {};
+    music.beat = 100;
+    handleMusicVisualization(music);
+
+    CRGB out[LED_BUFFER_SIZE] = {};
+    spectrumEffect(out);
+    int lit = 0;
+    for (int i = 0; i < NUM_LEDS; i++)
+        lit += out[i] != CRGB(CRGB::Black);
+    CHECK(lit == NUM_LEDS);
+}
+
+static void testMapsBuiltBesideActiveTable()
+{
+    CHECK(buildMatrixPixelMap({10, 6, true, 0}));
+    const uint16_t *before = xyTable;
+    uint16_t firstCell = before[0];
+
+    // An uploaded 2 x 1 map: LED 0 at (1, 0), LED 1 at (0, 0)
+    File file = LittleFS.open(PIXEL_MAP_PATH, "w");
+    const uint8_t map[] = {'L', 'P', 'M', '1', 2, 1, 2, 0, 1, 0, 0, 0};
+    file.write(map, sizeof(map));
+    file.close();
+    CHECK(loadPixelMap());
+
+    CHECK(xyTable != before);
+    CHECK(mapWidth == 2 && mapHeight == 1);
+    CHECK(xyTable[0] == 1 && xyTable[1] == 0);
+    CHECK(before[0] == firstCell);
+
+    // A truncated map is rejected and the active one stays
+    file = LittleFS.open(PIXEL_MAP_PATH, "w");
+    file.write(map, 6);
+    file.close();
+    const uint16_t *active = xyTable;
+    CHECK(!loadPixelMap());
+    CHECK(xyTable == active && mapWidth == 2 && xyTable[0] == 1);
+}
+
+int main()
+{
+    char root[] = "/tmp/pixel_map_testXXXXXX";
+    hostOptions.fsRoot = mkdtemp(root);
+    LittleFS.begin(true);
+    initializeColorKernels();
+
+    testSpectrumOnTallGrid();
+    testMapsBuiltBesideActiveTable();
+
+    return checkResult("pixel_map_test");
+}
@@ -0,0 +1,68 @@
+// Tempo tracker on the simulated frame clock: a steady beat locks with no
+// phase error, and the same input always predicts the same phase.
+#include <Arduino.h>
+#include "led_control.h"
+#include "led_output.h"
+#include "input_mailbox.h"
+#include "tempo_tracker.h"
+#include "mock_led_driver.h"
+#include "check.h"
+
+static const uint32_t BEAT_FRAMES = 50; // 120 BPM at FRAME_INTERVAL_MS 10
+static const uint32_t PERIOD_US = BEAT_FRAMES * FRAME_INTERVAL_MS * 1000UL;
+
+static void renderFrame()
+{
+    size_t target = mockFrames.size() + 1;
+    uint32_t start = millis();
+    while (mockFrames.size() < target && millis() - start < 1000)
+    {
+        handleLedStrip();
+        delay(1);
+    }
+}
+
+// Posts a music: frame before each rendered frame, a full beat every
+// BEAT_FRAMES, and returns the frame clock time of the last onset
+static uint32_t playBeats(int beats)
+{
+    uint32_t lastOnsetUs = 0;
+    for (uint32_t i = 0; i < beats * BEAT_FRAMES; i++)
+    {
+        MusicFrame frame = {};
+        frame.beat = i % BEAT_FRAMES == 0 ? 100 : 0;
+        if (frame.beat)
+            lastOnsetUs = frameClockMicros();
+        postMusicFrame(frame);
+        renderFrame();
+    }
+    return lastOnsetUs;
+}
+
+static void testSteadyBeatLocks()
+{
+    setSimulatedClock(true);
+    uint32_t lastOnsetUs = playBeats(8);
+
+    CHECK(tempoBpmTenths() == 1200);
+    CHECK(tempoStats.lastErrorUs == 0);
+    CHECK(tempoStats.outliers == 0);
+    CHECK(tempoLocked());
+
+    // Phase is a function of the frame clock alone
+    uint32_t leadUs = tempoLeadMs * 1000UL;
+    CHECK(tempoPredictedPhase(lastOnsetUs) == ((uint64_t)leadUs << 16) / PERIOD_US);
+    CHECK(tempoPredictedPhase(lastOnsetUs + PERIOD_US - leadUs) == 0);
+}
+
+int main()
+{
+    initializeLEDs();
+    CHECK(setLedDriver(&mockLedDriver));
+    stageMode(MODE_RAINBOW);
+    transitionDurationMs = 0;
+
+    testSteadyBeatLocks();
+
+    return checkResult("tempo_test");
+}
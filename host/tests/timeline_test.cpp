@@ -0,0 +1,92 @@
+// Timeline playback on the simulated frame clock: a looping timeline shows
+// its last cue before it restarts, and a loop with no length is refused.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <vector>
+#include "led_control.h"
+#include "led_output.h"
+#include "timeline.h"
+#include "mock_led_driver.h"
+#include "check.h"
+
+static void renderFrame()
+{
+    size_t target = mockFrames.size() + 1;
+    uint32_t start = millis();
+    while (mockFrames.size() < target && millis() - start < 1000)
+    {
+        handleLedStrip();
+        delay(1);
+    }
+}
+
+static void addCue(std::vector<uint8_t> &file, uint32_t timeMs, CueType type,
+                   std::initializer_list<uint8_t> payload)
+{
+    uint8_t header[] = {(uint8_t)timeMs, (uint8_t)(timeMs >> 8), (uint8_t)(timeMs >> 16), (uint8_t)(timeMs >> 24),
+                        (uint8_t)type, (uint8_t)payload.size(), 0};
+    file.insert(file.end(), header, header + sizeof(header));
+    file.insert(file.end(), payload);
+}
+
+static bool uploadTimeline(const std::vector<uint8_t> &cues, uint16_t cueCount, bool loop)
+{
+    // LTL1 header, flag bit 0 = loop
+    std::vector<uint8_t> file = {'L', 'T', 'L', '1', (uint8_t)(loop ? 1 : 0), 0,
+                                 (uint8_t)cueCount, (uint8_t)(cueCount >> 8)};
+    file.insert(file.end(), cues.begin(), cues.end());
+    return timelineUploadBegin() && timelineUploadWrite(file.data(), file.size()) && timelineUploadEnd();
+}
+
+static void testLastCueShownBeforeLoop()
+{
+    // Red from 0 ms, blue at 100 ms, then back to red
+    std::vector<uint8_t> cues;
+    addCue(cues, 0, CUE_MODE, {MODE_SOLID});
+    addCue(cues, 0, CUE_COLOR, {255, 0, 0});
+    addCue(cues, 100, CUE_COLOR, {0, 0, 255});
+    CHECK(uploadTimeline(cues, 3, true));
+
+    resetMockLedDriver();
+    CHECK(timelinePlay());
+    for (int i = 0; i < 35; i++)
+        renderFrame();
+    timelineStop();
+
+    // Each pass is 10 red frames and one blue one
+    int blue = 0;
+    int redAfterBlue = 0;
+    for (size_t i = 0; i < mockFrames.size(); i++)
+    {
+        bool isBlue = mockFrames[i].pixels[0] == CRGB(0, 0, 255);
+        blue += isBlue;
+        redAfterBlue += i > 0 && mockFrames[i - 1].pixels[0] == CRGB(0, 0, 255) &&
+                        mockFrames[i].pixels[0] == CRGB(255, 0, 0);
+    }
+    CHECK(blue == 3);
+    CHECK(redAfterBlue >= 2);
+}
+
+static void testZeroLengthLoopRefused()
+{
+    std::vector<uint8_t> cues;
+    addCue(cues, 0, CUE_MODE, {MODE_SOLID});
+    CHECK(!uploadTimeline(cues, 1, true));
+    CHECK(uploadTimeline(cues, 1, false));
+}
+
+int main()
+{
+    char root[] = "/tmp/timeline_testXXXXXX";
+    hostOptions.fsRoot = mkdtemp(root);
+    initializeLEDs();
+    initializeTimeline();
+    CHECK(setLedDriver(&mockLedDriver));
+    setSimulatedClock(true);
+    transitionDurationMs = 0;
+
+    testLastCueShownBeforeLoop();
+    testZeroLengthLoopRefused();
+
+    return checkResult("timeline_test");
+}
@@ -2,9 +2,12 @@
 #include <Arduino.h>
 
 // Auto-Update Functions
-void checkForFirmwareUpdate();
+void initializeAutoUpdate();
+void checkForFirmwareUpdate(bool ignoreRollout = false);
 void performAutoUpdate(String firmwareUrl);
+bool performManifestUpdate(const String &url, const String &sha256, size_t size);
 void handleAutoUpdate();
+bool setManifestUrl(const String &url);
 
 // Auto-Update State Variables
 extern unsigned long lastUpdateCheck;
@@ -12,3 +15,5 @@ extern bool autoUpdateEnabled;
 extern bool updateInProgress;
 extern String latestVersion;
 extern String updateStatus;
+extern String manifestUrl;    // LAN manifest, empty = GitHub releases
+extern uint8_t updateCohort; // 0-99, derived from the MAC address
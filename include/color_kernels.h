@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include <FastLED.h>
+
+// Whole-span color kernels. Each has a portable scalar version and a SWAR
+// version that works on four channels per 32-bit word; both produce the same
+// bytes. The math is FastLED's: scale8 = i * (1 + s) >> 8,
+// blend8 = (a * (256 - amt) + b * (1 + amt)) >> 8, hsv2rgb_rainbow hues.
+
+// Per-kernel timing from benchmarkColorKernels(), ns per pixel
+struct KernelBenchResult
+{
+    const char *name;
+    uint32_t scalarNs;
+    uint32_t swarNs;
+    bool exact; // Both versions wrote identical output
+};
+
+static const uint8_t COLOR_KERNEL_COUNT = 5;
+
+// Color Kernel Functions - the versions selected by COLOR_KERNELS_SWAR, for
+// the kernels effects render with
+void initializeColorKernels();
+void hsvToRgbSpan(const CHSV *in, CRGB *out, uint16_t count);
+void rainbowSpan(CRGB *out, uint16_t count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val);
+void blendSpan(const CRGB *from, const CRGB *to, CRGB *out, uint16_t count, uint8_t amount);
+CRGB hsvToRgb(const CHSV &hsv);
+uint8_t benchmarkColorKernels(KernelBenchResult *results);
+
+// Portable reference versions. No effect renders with scale or add yet, so
+// those two are only benchmarked and tested.
+void hsvToRgbSpanScalar(const CHSV *in, CRGB *out, uint16_t count);
+void rainbowSpanScalar(CRGB *out, uint16_t count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val);
+void scaleSpanScalar(CRGB *pixels, uint16_t count, uint8_t scale);
+void blendSpanScalar(const CRGB *from, const CRGB *to, CRGB *out, uint16_t count, uint8_t amount);
+void addSpanScalar(CRGB *pixels, const CRGB *add, uint16_t count);
+
+// Packed 32-bit versions
+void hsvToRgbSpanSwar(const CHSV *in, CRGB *out, uint16_t count);
+void rainbowSpanSwar(CRGB *out, uint16_t count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val);
+void scaleSpanSwar(CRGB *pixels, uint16_t count, uint8_t scale);
+void blendSpanSwar(const CRGB *from, const CRGB *to, CRGB *out, uint16_t count, uint8_t amount);
+void addSpanSwar(CRGB *pixels, const CRGB *add, uint16_t count);
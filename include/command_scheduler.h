@@ -0,0 +1,11 @@
+#pragma once
+#include <Arduino.h>
+#include "led_control.h"
+
+// Command Scheduler Functions - run commands when the shared clock reaches
+// a given time, so every unit applies them on the same frame
+bool scheduleCommand(uint32_t atMs, const String &command);
+bool scheduleState(uint32_t atMs, const StripState &state);
+void runScheduledCommands();
+void clearScheduledCommands();
+int scheduledCommandCount();
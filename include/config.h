@@ -8,12 +8,109 @@
 #define COLOR_ORDER GRB
 #define BRIGHTNESS 128
 #define BUILTIN_LED_PIN 2
+#define EFFECT_SPEED_DEFAULT 64 // Effect speed that matches the original animation rate
+
+// LED Output Configuration - the controller transmit runs on its own task while the next frame renders
+#define LED_OUTPUT_ASYNC 1    // 0 = transmit from loop() (output:sync switches at runtime)
+#define LED_OUTPUT_CORE 0     // Output task core, away from loop() on core 1
+#define LED_OUTPUT_PRIORITY 2 // Above loop() so a submitted frame starts at once
+#define LED_OUTPUT_STACK 3072        // showLeds() plus a margin; `output` reports stackFree
+#define LED_OUTPUT_STACK_MARGIN 1024 // Warn once if less than this was ever left free
+
+// Render Configuration
+#define FRAME_INTERVAL_MS 10         // Minimum time between frames (~100 fps)
+#define TRANSITION_DEFAULT_MS 400    // Default crossfade length, 0 = hard cut
+#define TRANSITION_MAX_MS 10000      // Longest accepted crossfade
+#define MUSIC_BEAT_HOLD_MS 50        // How long a music: beat flash stays on the strip
+#define MUSIC_BANDS 8                // Frequency bands kept from each music: frame
+
+// Tempo Tracker Configuration - a phase-locked loop on incoming beat onsets
+#define TEMPO_MIN_BPM 70           // Tracked range, half/double time folds into it
+#define TEMPO_MAX_BPM 180
+#define TEMPO_LEAD_DEFAULT_MS 60   // Render ahead by the input path latency (tempo:lead:<ms>)
+#define TEMPO_LEAD_MAX_MS 250
+#define TEMPO_LOCK_WINDOW 20       // Onsets within this % of a period correct the loop
+#define TEMPO_PHASE_GAIN 4         // Phase correction = error / gain
+#define TEMPO_PERIOD_GAIN 16       // Tempo correction = error / gain
+#define TEMPO_CONFIDENCE_STEP 10   // Confidence gained per on-grid onset (lost x2 per outlier)
+#define TEMPO_LOCK_CONFIDENCE 50   // Predicted beats replace reactive ones from here
+#define TEMPO_HOLD_BEATS 4         // Beats without onsets before confidence fades
+#define TEMPO_ONSET_LEVEL 50       // music: beat value that counts as an onset
+#define TEMPO_REARM_MS 100         // A strong frame after this gap is a new onset
+
+// Pixel Map Configuration - built-in layout, baked into a lookup table at compile time
+#define MATRIX_WIDTH 10            // Physical panel columns
+#define MATRIX_HEIGHT 6            // Physical panel rows
+#define MATRIX_SERPENTINE true     // Odd rows run right to left
+#define MATRIX_ROTATION 0          // Quarter turns clockwise (0-3)
+#define PIXEL_MAP_MAX_CELLS 1024   // Largest grid an uploaded map may use
+#define PIXEL_MAP_PATH "/pixelmap.bin"
+#define PIXEL_MAP_UPLOAD_PATH "/pixelmap.tmp"
+
+// Color Kernel Configuration
+#define COLOR_KERNELS_SWAR 1 // 1 = packed 32-bit kernels, 0 = portable scalar ones (same output)
+
+// Effect VM Configuration
+#define VM_MAX_INSTRUCTIONS 64  // Longest compiled per-pixel program
+#define VM_FRAME_BUDGET 20000   // Instructions per frame (program length x NUM_LEDS)
+#define VM_SOURCE_MAX 256       // Longest program source
+#define VM_PROGRAM_PATH "/effect.vm"
 
 // Serial Configuration
 #define SERIAL_TIMEOUT 30000 // 30 seconds
+#define SERIAL_LINE_MAX 256  // Longest accepted command line (batches included)
+#define SERIAL_RX_BUFFER 4096 // UART receive buffer, absorbs bursts and streamed frames between loop() passes
+#define SERIAL_BAUD_DEFAULT 115200 // Rate at boot and after a failed baud: negotiation
+#define BAUD_CONFIRM_MS 2000       // Host must send baud:ok at the new rate within this
+#define STREAM_START_BYTE 0xFE     // Starts a binary pixel frame (never in a text command)
+#define STREAM_FRAME_TIMEOUT_MS 200 // A partial binary frame older than this is dropped
+
+// Idle Scheduler Configuration - OFF or static SOLID with no input drops the loop rate
+#define POWER_IDLE_ENTER_MS 2000 // Quiet time before the loop slows down
+#define POWER_IDLE_POLL_MS 50    // Loop period when idle with Wi-Fi down (one frame while connected)
+#define POWER_IDLE_WIFI_SLEEP WIFI_PS_MAX_MODEM // Wi-Fi power save while idle, previous mode restored after
+#define POWER_BUSY_MA 110        // Estimated draw running loop() work, Wi-Fi awake
+#define POWER_WAIT_MA 45         // Estimated draw between full-rate loop passes
+#define POWER_IDLE_MA 25         // Estimated draw idle with modem sleep
+#define POWER_SLEEP_MA 4         // Estimated draw idle with automatic light sleep
+
+// Logging Configuration
+#define LOG_COMPILE_LEVEL 4     // Highest level compiled in (0=none, 1=error, 2=warn, 3=info, 4=debug)
+#define LOG_RUNTIME_LEVEL 3     // Default runtime level, adjustable with log:<level>
+#define LOG_BUFFER_SIZE 2048    // Log ring buffer size in bytes (power of two)
+#define RESPONSE_BUFFER_SIZE 512 // Protocol response ring size in bytes (power of two)
+#define LOG_LINE_MAX 256        // Longest single log or response line
+
+// Timeline Configuration
+#define TIMELINE_PATH "/timeline.bin"
+#define TIMELINE_UPLOAD_PATH "/timeline.tmp"
+#define TIMELINE_READAHEAD 128 // Flash read-ahead buffer for cue and keyframe data
+
+// Frame Capture Configuration
+#define CAPTURE_PATH "/capture.lcp"
+#define CAPTURE_GOLDEN_PREFIX "/golden_" // Golden captures are /golden_<name>.lcp
+#define CAPTURE_MAX_FRAMES 6000          // One minute at FRAME_INTERVAL_MS 10
+
+// Time Sync Configuration
+#define SYNC_PORT 4210                // UDP port for clock sync exchanges
+#define SYNC_INTERVAL_MS 1000         // Time between sync requests from a slave
+#define SYNC_FILTER_SIZE 8            // Samples considered when picking the lowest-delay one
+#define SYNC_DELAY_TOLERANCE_US 2000  // Accept samples within this of the best recent delay
+#define SYNC_STEP_THRESHOLD_US 50000  // Larger errors step the clock instead of slewing
+#define SCHEDULE_SLOTS 8              // Commands that can wait for an @time
+
+// Scene Configuration
+#define SCENE_NAME_MAX 15 // NVS key length limit
+
+// Firmware Upload Configuration
+#define UPDATE_RENDER_INTERVAL_MS 40     // Strip keeps animating at 25 fps while flashing
+#define UPDATE_PROGRESS_INTERVAL_MS 1000 // Minimum time between progress log lines
 
 // Auto-Update Configuration
 #define UPDATE_CHECK_INTERVAL 3600000 // Check every hour (3600000ms)
+#define UPDATE_CHECK_JITTER 600000    // Up to 10 minutes added per check so a fleet spreads out
+#define UPDATE_STALL_TIMEOUT_MS 10000 // Abort a manifest download that stops sending
+#define FIRMWARE_BOARD "esp32doit-devkit-v1" // Image key looked up in a LAN manifest
 
 // Device Info
 extern const String DEVICE_NAME;
@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <FastLED.h>
+#include "config.h"
+#include "input_mailbox.h"
+
+// Register-based effect VM. Values are 16.16 fixed point; one instruction
+// reads up to two registers and writes one. Programs have no jumps, so the
+// cost of a frame is known when the program is compiled.
+static const uint8_t VM_REGISTERS = 32;
+
+// Longest accepted program: VM_MAX_INSTRUCTIONS, or less when the strip is
+// long enough that VM_FRAME_BUDGET is the tighter bound
+static const uint16_t VM_INSTRUCTION_LIMIT = VM_FRAME_BUDGET / NUM_LEDS < VM_MAX_INSTRUCTIONS
+                                                 ? VM_FRAME_BUDGET / NUM_LEDS
+                                                 : VM_MAX_INSTRUCTIONS;
+
+struct VmInstruction
+{
+    uint8_t op;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+};
+
+struct VmProgram
+{
+    VmInstruction code[VM_MAX_INSTRUCTIONS];
+    uint8_t length;
+    int32_t constants[VM_REGISTERS]; // Preloaded into their registers each frame
+    uint8_t constantBase;
+    uint8_t constantCount;
+    bool rgb; // Outputs are r, g, b instead of h, s, v
+};
+
+// Effect VM Functions
+void initializeEffectVm();
+bool vmCompile(const char *source, VmProgram &program, char *error, size_t errorSize);
+bool vmLoadProgram(const String &source, char *error, size_t errorSize);
+void vmRenderEffect(CRGB *out, uint32_t timeMs, const MusicFrame &music, uint16_t phase);
+void vmBenchmark(uint32_t &vmNs, uint32_t &rainbowNs, uint32_t &visualizerNs);
+
+// Effect VM State Variables
+extern VmProgram vmProgram;
+extern String vmSource;
@@ -0,0 +1,15 @@
+#pragma once
+#include <Arduino.h>
+
+// Firmware Writer Functions - streams an image into the OTA partition,
+// hashing it as it arrives. Shared by every update path.
+bool firmwareBegin(size_t size, const String &expectedSha256);
+bool firmwareWrite(const uint8_t *data, size_t length);
+bool firmwareEnd();
+void firmwareAbort();
+
+// Firmware Writer State Variables
+extern bool firmwareWriting;
+extern size_t firmwareWritten;
+extern size_t firmwareSize;   // 0 when the sender did not say
+extern char firmwareError[64];
@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+#include <FastLED.h>
+
+// Result of diffing the last capture against a golden capture
+struct CaptureComparison
+{
+    uint32_t frames;           // Frames compared
+    uint32_t mismatchedFrames; // Frames with any channel outside tolerance
+    uint32_t firstFrame;       // Index of the first mismatched frame
+    uint16_t firstPixel;       // First out-of-tolerance pixel in that frame
+    uint8_t maxDiff;           // Largest channel difference seen
+    bool lengthMismatch;       // Captures differ in frame count or timing
+};
+
+// Frame Capture Functions
+bool captureStart(uint32_t frames);
+void captureStop();
+void captureFrame(const CRGB *frame, uint8_t brightness, uint32_t timeMs);
+bool captureSave(const String &name);
+bool captureCompare(const String &name, uint8_t tolerance, CaptureComparison &result);
+
+// Frame Capture State Variables
+extern bool captureActive;
+extern uint32_t captureFrameCount;
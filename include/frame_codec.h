@@ -0,0 +1,17 @@
+#pragma once
+#include <FastLED.h>
+
+// Frame Codec Functions
+//
+// Changed-run delta encoding against the previous frame. The stream is a
+// sequence of runs: u8 unchanged pixels to skip, u8 changed pixel count,
+// then r,g,b for each changed pixel. A skip longer than 255 is written as
+// a run with count 0. Trailing unchanged pixels are not written.
+
+// Returns bytes written, or 0 if the encoding would not fit in capacity
+size_t encodeDeltaRuns(const CRGB *frame, const CRGB *previous, uint16_t count,
+                       uint8_t *out, size_t capacity);
+
+// Applies runs to frame in place (frame holds the previous frame on entry).
+// Returns false on malformed or out-of-range input.
+bool decodeDeltaRuns(const uint8_t *data, size_t length, CRGB *frame, uint16_t count);
@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+
+// Binary pixel frames interleaved with text commands on the serial link:
+//   STREAM_START_BYTE, u8 type, u16 payload length, payload, u8 checksum
+// The checksum is the low byte of the sum of type, length and payload bytes.
+enum StreamFrameType
+{
+    STREAM_FRAME_FULL = 1,    // r, g, b per pixel from LED 0
+    STREAM_FRAME_DELTA = 2,   // Changed runs against the previous frame (frame_codec.h)
+    STREAM_FRAME_PALETTE = 3  // u8 palette size (0 = 256), palette r, g, b, u8 index per pixel
+};
+
+struct FrameStreamStats
+{
+    uint32_t frames;
+    uint32_t deltaFrames;
+    uint32_t paletteFrames;
+    uint32_t errors;
+    uint32_t bytes;
+    unsigned long startMs;
+};
+
+// Frame Stream Functions
+void frameStreamStart();
+bool frameStreamActive();
+void frameStreamCheckTimeout();
+void frameStreamRead(Stream &input, int &budget);
+void resetFrameStreamStats();
+
+// Frame Stream State Variables
+extern FrameStreamStats frameStreamStats;
@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// One parsed music: update ("band1,band2,...,beat", values 0-100)
+struct MusicFrame
+{
+    uint32_t receivedUs; // micros() when the input arrived
+    int beat;
+    uint8_t bandCount;
+    uint8_t bands[MUSIC_BANDS];
+};
+
+// Latency histogram: 4 sub-buckets per power of two (about 19% resolution)
+#define LATENCY_SUB_BUCKETS 4
+#define LATENCY_BUCKETS (32 * LATENCY_SUB_BUCKETS)
+
+// Input-to-display statistics
+struct InputStats
+{
+    uint32_t received;  // Music frames posted
+    uint32_t coalesced; // Frames overwritten before a render picked them up
+    uint32_t displayed; // Frames that reached the strip
+    uint32_t lastLatencyUs;
+    uint32_t maxLatencyUs;
+    uint64_t totalLatencyUs;
+    uint32_t startMs;   // When counting started, for throughput
+    uint32_t histogram[LATENCY_BUCKETS];
+};
+
+// Input Mailbox Functions - latest-wins slot between inputs and the renderer
+bool parseMusicData(const String &data, MusicFrame &frame);
+void postMusicFrame(const MusicFrame &frame);
+bool takeMusicFrame(MusicFrame &frame);
+void recordInputLatency(uint32_t latencyUs);
+void resetInputStats();
+uint32_t latencyPercentile(uint8_t percent);
+
+// Input Mailbox State Variables
+extern InputStats inputStats;
@@ -1,5 +1,6 @@
 #pragma once
 #include <FastLED.h>
+#include "input_mailbox.h"
 
 // LED Strip modes
 enum LedMode
@@ -7,19 +8,83 @@ enum LedMode
     MODE_OFF,
     MODE_SOLID,
     MODE_RAINBOW,
-    MODE_VISUALIZER
+    MODE_VISUALIZER,
+    MODE_PIXELS,     // Externally supplied frame in pixelFrame[] (timeline keyframes, USB stream)
+    MODE_RAINBOW_2D, // Diagonal rainbow across the pixel map
+    MODE_SPECTRUM,   // Band energies as columns on the pixel map
+    MODE_VM,         // User program run by the effect VM
+    MODE_COUNT
+};
+
+// Transition easing curves
+enum EasingCurve
+{
+    EASE_LINEAR,
+    EASE_QUAD,
+    EASE_CUBIC
+};
+
+// Complete strip state. Commands stage changes into pendingState and the
+// render loop applies them together at the next frame boundary.
+struct StripState
+{
+    LedMode mode;
+    CRGB color;
+    uint8_t brightness;
+    uint8_t speed; // Effect animation speed, EFFECT_SPEED_DEFAULT = original rate
+};
+
+// Per-frame timing, all in microseconds
+struct FrameMetrics
+{
+    uint32_t frames;
+    uint32_t renderUs;     // Effect rendering, including any transition
+    uint32_t renderMaxUs;
+    uint32_t transitionUs; // Outgoing render + blend while a transition runs
+    uint32_t transitionMaxUs;
+    uint32_t showUs;       // Handing the frame to the LED driver, fence wait included
 };
 
 // LED Control Functions
 void initializeLEDs();
-void setStripColor(CRGB color);
-void rainbowEffect();
-void musicVisualizerEffect();
+void rainbowEffect(CRGB *out);
+void musicVisualizerEffect(CRGB *out);
+void rainbow2DEffect(CRGB *out);
+void spectrumEffect(CRGB *out);
+void renderStripState(const StripState &state, CRGB *out);
 void handleLedStrip();
-void handleMusicVisualization(String musicData);
+void handleLedStripDuringUpdate();
+bool ledStripIdle();
+void benchmarkBuiltinEffects(CRGB *scratch, uint16_t frames, uint32_t &rainbowNs, uint32_t &visualizerNs);
+void handleMusicVisualization(const MusicFrame &music);
+
+// State Staging Functions
+void stageMode(LedMode mode);
+void stageColor(CRGB color);
+void stageBrightness(uint8_t brightness);
+void stageSpeed(uint8_t speed);
+void stageState(const StripState &state);
+void applyPendingState();
+bool parseLedMode(const String &name, LedMode &mode);
+bool parseColor(const String &name, CRGB &color);
+bool parseEasing(const String &name, EasingCurve &curve);
+const char *ledModeName(LedMode mode);
+const char *easingName(EasingCurve curve);
+void resetFrameMetrics();
+void setSimulatedClock(bool enabled);
+uint32_t frameClockMillis();
+uint32_t frameClockMicros();
 
 // LED State Variables
 extern CRGB leds[];
+extern CRGB pixelFrame[];
 extern LedMode currentMode;
 extern CRGB currentColor;
+extern uint8_t currentBrightness;
+extern uint8_t effectSpeed;
 extern bool ledState;
+extern StripState pendingState;
+extern bool statePending;
+extern uint16_t transitionDurationMs;
+extern EasingCurve transitionEasing;
+extern FrameMetrics frameMetrics;
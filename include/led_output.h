@@ -0,0 +1,35 @@
+#pragma once
+#include <FastLED.h>
+
+// LED output driver. submit() hands over a finished frame and returns once
+// the driver holds its own copy; waitIdle() is the fence for anything that
+// needs the previous frame on the strip first.
+struct LedDriver
+{
+    const char *name;
+    bool (*begin)();
+    void (*submit)(const CRGB *frame, uint8_t brightness);
+    void (*waitIdle)();
+};
+
+// Output timing, all in microseconds
+struct LedOutputStats
+{
+    uint32_t frames;
+    uint32_t fenceWaitUs;    // Submit blocked on the previous transmission
+    uint32_t fenceWaitMaxUs;
+    uint32_t transmitUs;     // Controller showLeds() for the last frame
+    uint32_t transmitMaxUs;
+    uint32_t stackFreeMin;   // Output task stack never used, in bytes (async only)
+};
+
+// LED Output Functions
+void initializeLedOutput();
+bool setLedDriver(const LedDriver *driver);
+void resetLedOutputStats();
+
+// LED Output State Variables
+extern const LedDriver syncLedDriver;
+extern const LedDriver asyncLedDriver;
+extern const LedDriver *ledDriver;
+extern LedOutputStats ledOutputStats;
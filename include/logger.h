@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Log Levels (lower is more severe)
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Logging Macros - messages above LOG_COMPILE_LEVEL are compiled out entirely
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(tag, ...) logWrite(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOG_E(tag, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(tag, ...) logWrite(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOG_W(tag, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(tag, ...) logWrite(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOG_I(tag, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(tag, ...) logWrite(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOG_D(tag, ...) ((void)0)
+#endif
+
+// Logging Functions
+void logWrite(uint8_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void sendResponse(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void sendResponseV(const char *format, va_list args);
+void logFlush();
+void logFlushAll();
+bool logOutputPending();
+bool parseLogLevel(const String &name, uint8_t &level);
+const char *logLevelName(uint8_t level);
+
+// Logging State Variables
+extern uint8_t logLevel;
+extern bool quietMode;
+extern uint32_t logDropped;
@@ -6,4 +6,4 @@ void setupOTA();
 
 // OTA State Variables
 extern bool otaInProgress;
-extern String otaStatus;
+extern char otaStatus[48];
@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Effects render into NUM_LEDS + 1 pixels. Grid cells with no LED point at
+// the extra scratch pixel, so 2D render loops never need a branch.
+static const uint16_t PIXEL_SCRATCH = NUM_LEDS;
+#define LED_BUFFER_SIZE (NUM_LEDS + 1)
+
+// Rectangular panel wiring, in physical rows and columns
+struct MatrixLayout
+{
+    uint8_t width;
+    uint8_t height;
+    bool serpentine;
+    uint8_t rotation; // Quarter turns clockwise
+};
+
+// Flat XY lookup table: index[y * width + x] is the LED at logical (x, y)
+template <size_t N>
+struct XYTable
+{
+    uint16_t index[N];
+};
+
+constexpr uint8_t logicalWidth(const MatrixLayout &layout)
+{
+    return (layout.rotation & 1) ? layout.height : layout.width;
+}
+
+constexpr uint8_t logicalHeight(const MatrixLayout &layout)
+{
+    return (layout.rotation & 1) ? layout.width : layout.height;
+}
+
+// LED index for logical (x, y) after undoing rotation and serpentine wiring
+constexpr uint16_t matrixLedIndex(const MatrixLayout &layout, uint16_t x, uint16_t y)
+{
+    uint16_t px = x;
+    uint16_t py = y;
+    switch (layout.rotation & 3)
+    {
+    case 1:
+        px = y;
+        py = layout.height - 1 - x;
+        break;
+    case 2:
+        px = layout.width - 1 - x;
+        py = layout.height - 1 - y;
+        break;
+    case 3:
+        px = layout.width - 1 - y;
+        py = x;
+        break;
+    }
+    if (layout.serpentine && (py & 1))
+        px = layout.width - 1 - px;
+
+    uint32_t index = (uint32_t)py * layout.width + px;
+    return index < NUM_LEDS ? index : PIXEL_SCRATCH;
+}
+
+template <size_t N>
+constexpr XYTable<N> buildMatrixTable(const MatrixLayout &layout)
+{
+    XYTable<N> table = {};
+    uint16_t width = logicalWidth(layout);
+    for (size_t i = 0; i < N; i++)
+    {
+        table.index[i] = matrixLedIndex(layout, i % width, i / width);
+    }
+    return table;
+}
+
+// Pixel Map Functions
+void initializePixelMap();
+void useBuiltinPixelMap();
+bool buildMatrixPixelMap(const MatrixLayout &layout);
+bool loadPixelMap();
+bool pixelMapUploadBegin();
+bool pixelMapUploadWrite(const uint8_t *data, size_t length);
+bool pixelMapUploadEnd();
+
+// Pixel Map State Variables
+extern const uint16_t *xyTable; // Active table, mapWidth * mapHeight entries
+extern uint16_t mapWidth;
+extern uint16_t mapHeight;
+extern bool mapCoversAllLeds;   // False if some LEDs sit outside the grid
+extern const char *mapSource;   // "builtin", "matrix" or "uploaded"
@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+// Idle scheduler counters, all times in microseconds
+struct PowerStats
+{
+    uint32_t idleEntries;      // Times the loop dropped to the idle rate
+    uint32_t wakeups;          // Idle waits cut short by serial input
+    uint32_t wakeLatencyUs;    // Input arrival to loop() running, last wakeup
+    uint32_t wakeLatencyMaxUs;
+    uint64_t busyUs;           // Running loop() work
+    uint64_t waitUs;           // Waiting between full-rate loop passes
+    uint64_t idleUs;           // Waiting at the idle rate, CPU clocked
+    uint64_t sleepUs;          // Waiting at the idle rate with light sleep allowed
+};
+
+// Power Manager Functions
+void initializePowerManager();
+void powerLoopWait();
+void powerWake();
+void notePowerActivity();
+uint32_t estimatedCurrentMa();
+void resetPowerStats();
+
+// Power Manager State Variables
+extern bool powerSaveEnabled;
+extern bool powerIdleActive;
+extern bool lightSleepAvailable;
+extern PowerStats powerStats;
@@ -0,0 +1,9 @@
+#pragma once
+#include <Arduino.h>
+#include "led_control.h"
+
+// Scene Functions - named StripState snapshots persisted in NVS
+bool saveScene(const String &name, const StripState &state);
+bool loadScene(const String &name, StripState &state);
+bool deleteScene(const String &name);
+bool isValidSceneName(const String &name);
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+#include "input_mailbox.h"
+
+// Phase-locked loop counters
+struct TempoStats
+{
+    uint32_t onsets;     // Beat onsets fed to the tracker
+    uint32_t inWindow;   // Onsets close enough to a predicted beat to correct it
+    uint32_t outliers;   // Fills, syncopation or a tempo change
+    int32_t lastErrorUs; // Last onset minus its predicted beat
+    uint8_t lastLevel;   // Beat value of the last onset
+};
+
+// Tempo Tracker Functions
+void tempoFeedMusic(const MusicFrame &frame);
+void tempoOnset(uint32_t timeUs, uint8_t level);
+uint16_t tempoPhaseAt(uint32_t timeUs);
+uint16_t tempoPredictedPhase(uint32_t frameUs);
+bool tempoLocked();
+uint8_t tempoConfidence();
+uint16_t tempoBpmTenths();
+void resetTempo();
+
+// Tempo Tracker State Variables
+extern uint16_t tempoLeadMs;
+extern TempoStats tempoStats;
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Time sync roles
+enum SyncRole
+{
+    SYNC_OFF,    // Free-running local clock
+    SYNC_MASTER, // Answer sync requests on SYNC_PORT
+    SYNC_SLAVE,  // Follow a master over UDP
+    SYNC_SERIAL  // Follow the USB host (host answers sync requests)
+};
+
+// Offset and drift estimate against the master
+struct SyncStats
+{
+    int64_t offsetUs;   // Master time minus local time at the reference point
+    int32_t driftPpb;   // Local clock rate error, parts per billion
+    uint32_t delayUs;   // Round-trip delay of the last accepted sample
+    uint32_t samples;   // Accepted samples
+    uint32_t rejected;  // Samples dropped by the delay filter
+    uint32_t lastSyncMs;
+};
+
+// Time Sync Functions
+void handleTimeSync();
+uint64_t syncedMicros();
+uint32_t syncedMillis();
+bool startSyncMaster();
+bool startSyncSlave(const IPAddress &master);
+void startSerialSync();
+void stopTimeSync();
+bool handleSerialSyncReply(const String &args);
+void noteSerialLine();
+const char *syncRoleName(SyncRole role);
+
+// Time Sync State Variables
+extern SyncRole syncRole;
+extern SyncStats syncStats;
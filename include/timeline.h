@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+
+// Timeline cue types (see TIMELINE_GUIDE.md for the file format)
+enum CueType
+{
+    CUE_MODE = 1,       // u8 LedMode
+    CUE_COLOR = 2,      // u8 r, g, b
+    CUE_BRIGHTNESS = 3, // u8 brightness
+    CUE_SPEED = 4,      // u8 effect speed
+    CUE_KEYFRAME = 5    // r, g, b per pixel, shown in MODE_PIXELS
+};
+
+// Timeline Functions
+void initializeTimeline();
+void timelineTick(unsigned long frameTime);
+bool timelinePlay();
+void timelineStop();
+bool timelineSeek(uint32_t positionMs);
+bool timelineUploadBegin();
+bool timelineUploadWrite(const uint8_t *data, size_t length);
+bool timelineUploadEnd();
+bool timelineAvailable();
+
+// Timeline State Variables
+extern bool timelinePlaying;
+extern uint32_t timelinePositionMs;
+extern uint16_t timelineCueCount;
@@ -11,6 +11,16 @@ void handleStripMode();
 void handleStripColor();
 void handleAutoUpdateWeb();
 void handleMusicData();
+void handleStateApi();
+void handleTimelineUpload();
+void handleTimelineUploadDone();
+void handleTimelineWeb();
+void handleCaptureDownload();
+void handleFirmwareUpload();
+void handleFirmwareUploadDone();
+void handlePixelMapUpload();
+void handlePixelMapUploadDone();
+void handleEffectApi();
 
 // Web Server Instance
 extern WebServer server;
@@ -4,6 +4,10 @@
 #include <HTTPUpdate.h>
 #include <ArduinoJson.h>
 #include <WiFi.h>
+#include "logger.h"
+#include "led_control.h"
+#include "firmware_writer.h"
+#include <Preferences.h>
 
 // Auto-Update State Variables
 unsigned long lastUpdateCheck = 0;
@@ -11,12 +15,133 @@ bool autoUpdateEnabled = true;
 bool updateInProgress = false;
 String latestVersion = "";
 String updateStatus = "Ready";
+String manifestUrl = "";
+uint8_t updateCohort = 0;
 
-void checkForFirmwareUpdate()
+static const char *UPDATE_NAMESPACE = "update";
+static unsigned long updateCheckInterval = UPDATE_CHECK_INTERVAL;
+
+void initializeAutoUpdate()
+{
+    Preferences prefs;
+    prefs.begin(UPDATE_NAMESPACE, true);
+    manifestUrl = prefs.getString("manifest", "");
+    prefs.end();
+
+    // FNV-1a of the MAC gives every unit a fixed rollout cohort
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 6; i++)
+    {
+        hash = (hash ^ mac[i]) * 16777619u;
+    }
+    updateCohort = hash % 100;
+
+    // Jittered so units powered on together don't all check at once
+    updateCheckInterval = UPDATE_CHECK_INTERVAL + random(UPDATE_CHECK_JITTER);
+
+    if (manifestUrl.length() > 0)
+        LOG_I("UPD", "Update manifest: %s (cohort %u)", manifestUrl.c_str(), updateCohort);
+}
+
+bool setManifestUrl(const String &url)
+{
+    if (url.length() > 0 && !url.startsWith("http://") && !url.startsWith("https://"))
+        return false;
+
+    Preferences prefs;
+    prefs.begin(UPDATE_NAMESPACE, false);
+    bool ok = true;
+    if (url.length() > 0)
+        ok = prefs.putString("manifest", url) == url.length();
+    else
+        prefs.remove("manifest");
+    prefs.end();
+
+    if (ok)
+        manifestUrl = url;
+    return ok;
+}
+
+// Manifest format:
+//   {"version":"v1.4.0","rollout":25,
+//    "boards":{"esp32doit-devkit-v1":{"url":"http://...","sha256":"...","size":912345}}}
+// rollout is the percentage of cohorts (0-99) that install it, 100 if omitted.
+// sha256 and size are required, an image is never installed unverified.
+static void checkManifest(bool ignoreRollout)
+{
+    HTTPClient http;
+    http.begin(manifestUrl);
+
+    int httpCode = http.GET();
+    if (httpCode != HTTP_CODE_OK)
+    {
+        LOG_E("UPD", "Error fetching manifest: %d", httpCode);
+        updateStatus = "Check failed";
+        http.end();
+        return;
+    }
+
+    StaticJsonDocument<128> filter;
+    filter["version"] = true;
+    filter["rollout"] = true;
+    filter["boards"][FIRMWARE_BOARD] = true;
+
+    DynamicJsonDocument doc(1024);
+    DeserializationError error = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+    http.end();
+
+    JsonObject image = doc["boards"][FIRMWARE_BOARD];
+    if (error || !doc["version"].is<const char *>() || image.isNull() || !image["url"].is<const char *>())
+    {
+        LOG_E("UPD", "Manifest has no image for %s", FIRMWARE_BOARD);
+        updateStatus = "Check failed";
+        return;
+    }
+
+    const char *sha256 = image["sha256"] | "";
+    uint32_t size = image["size"] | 0;
+    if (strlen(sha256) != 64 || size == 0)
+    {
+        LOG_E("UPD", "Manifest image for %s has no sha256 or size", FIRMWARE_BOARD);
+        updateStatus = "Check failed";
+        return;
+    }
+
+    latestVersion = doc["version"].as<String>();
+    if (latestVersion == "v" + FIRMWARE_VERSION)
+    {
+        LOG_I("UPD", "Firmware is up to date");
+        updateStatus = "Up to date";
+        return;
+    }
+
+    int rollout = doc["rollout"] | 100;
+    LOG_I("UPD", "New version available: %s (rollout %d%%, cohort %u)", latestVersion.c_str(), rollout, updateCohort);
+    updateStatus = "Update available: " + latestVersion;
+
+    if (!ignoreRollout && updateCohort >= rollout)
+    {
+        updateStatus += " (not in rollout)";
+        return;
+    }
+    if (autoUpdateEnabled || ignoreRollout)
+        performManifestUpdate(image["url"].as<String>(), sha256, size);
+}
+
+
+void checkForFirmwareUpdate(bool ignoreRollout)
 {
     if (WiFi.status() != WL_CONNECTED)
     {
-        Serial.println("Not connected to WiFi, skipping update check");
+        LOG_W("UPD", "Not connected to WiFi, skipping update check");
+        return;
+    }
+
+    if (manifestUrl.length() > 0)
+    {
+        checkManifest(ignoreRollout);
         return;
     }
 
@@ -35,14 +160,14 @@ void checkForFirmwareUpdate()
         if (!error)
         {
             latestVersion = doc["tag_name"].as<String>();
-            Serial.println("Latest version: " + latestVersion);
+            LOG_I("UPD", "Latest version: %s", latestVersion.c_str());
 
             // Compare with current version using FIRMWARE_VERSION
             const String CURRENT_VERSION = "v" + FIRMWARE_VERSION;
 
             if (latestVersion != CURRENT_VERSION)
             {
-                Serial.println("New version available: " + latestVersion);
+                LOG_I("UPD", "New version available: %s", latestVersion.c_str());
                 updateStatus = "Update available: " + latestVersion;
 
                 if (autoUpdateEnabled)
@@ -53,19 +178,19 @@ void checkForFirmwareUpdate()
             }
             else
             {
-                Serial.println("Firmware is up to date");
+                LOG_I("UPD", "Firmware is up to date");
                 updateStatus = "Up to date";
             }
         }
         else
         {
-            Serial.println("Error parsing update response");
+            LOG_E("UPD", "Error parsing update response");
             updateStatus = "Check failed";
         }
     }
     else
     {
-        Serial.println("Error checking for updates: " + String(httpCode));
+        LOG_E("UPD", "Error checking for updates: %d", httpCode);
         updateStatus = "Check failed";
     }
 
@@ -76,35 +201,44 @@ void performAutoUpdate(String updateUrl)
 {
     if (updateInProgress)
     {
-        Serial.println("Update already in progress");
+        LOG_W("UPD", "Update already in progress");
         return;
     }
 
     updateInProgress = true;
     updateStatus = "Downloading...";
-    Serial.println("Starting firmware update from: " + updateUrl);
+    LOG_I("UPD", "Starting firmware update from: %s", updateUrl.c_str());
 
     WiFiClient client;
     HTTPUpdate httpUpdate;
 
     httpUpdate.onStart([]()
                        {
-    Serial.println("Update started");
+    LOG_I("UPD", "Update started");
     updateStatus = "Installing..."; });
 
     httpUpdate.onEnd([]()
                      {
-    Serial.println("Update finished");
+    LOG_I("UPD", "Update finished");
     updateStatus = "Complete - Restarting..."; });
 
     httpUpdate.onProgress([](int cur, int total)
                           {
-    Serial.printf("Update progress: %d%%\n", (cur * 100) / total);
-    updateStatus = "Installing... " + String((cur * 100) / total) + "%"; });
+    handleLedStripDuringUpdate();
+
+    static int lastPercent = -1;
+    int percent = (cur * 100) / total;
+    if (percent == lastPercent)
+      return;
+    lastPercent = percent;
+
+    updateStatus = "Installing... " + String(percent) + "%";
+    if (percent % 10 == 0)
+      LOG_I("UPD", "Update progress: %d%%", percent); });
 
     httpUpdate.onError([](int error)
                        {
-    Serial.printf("Update error: %d\n", error);
+    LOG_E("UPD", "Update error: %d", error);
     updateStatus = "Update failed";
     updateInProgress = false; });
 
@@ -113,16 +247,17 @@ void performAutoUpdate(String updateUrl)
     switch (ret)
     {
     case HTTP_UPDATE_FAILED:
-        Serial.printf("Update failed: %s\n", httpUpdate.getLastErrorString().c_str());
+        LOG_E("UPD", "Update failed: %s", httpUpdate.getLastErrorString().c_str());
         updateStatus = "Failed: " + httpUpdate.getLastErrorString();
         break;
     case HTTP_UPDATE_NO_UPDATES:
-        Serial.println("No update needed");
+        LOG_I("UPD", "No update needed");
         updateStatus = "No update needed";
         break;
     case HTTP_UPDATE_OK:
-        Serial.println("Update successful");
+        LOG_I("UPD", "Update successful");
         updateStatus = "Update successful";
+        logFlushAll();
         ESP.restart();
         break;
     }
@@ -130,13 +265,102 @@ void performAutoUpdate(String updateUrl)
     updateInProgress = false;
 }
 
+// Downloads an image named by a manifest through the hash-verified writer.
+// The hash and size are required, and the server must agree on the size.
+bool performManifestUpdate(const String &url, const String &sha256, size_t size)
+{
+    if (sha256.length() == 0 || size == 0)
+    {
+        LOG_E("UPD", "Refusing an image without sha256 and size");
+        updateStatus = "Failed: unverified image";
+        return false;
+    }
+    if (updateInProgress)
+    {
+        LOG_W("UPD", "Update already in progress");
+        return false;
+    }
+
+    updateInProgress = true;
+    updateStatus = "Downloading...";
+    LOG_I("UPD", "Starting firmware update from: %s", url.c_str());
+
+    HTTPClient http;
+    http.begin(url);
+    int httpCode = http.GET();
+    int length = http.getSize();
+    if (httpCode != HTTP_CODE_OK)
+    {
+        LOG_E("UPD", "Image download failed: %d", httpCode);
+        updateStatus = "Failed: download";
+        updateInProgress = false;
+        http.end();
+        return false;
+    }
+    // A chunked response has no length (-1), any other must match
+    if (length >= 0 && (size_t)length != size)
+    {
+        LOG_E("UPD", "Image is %d bytes, manifest says %u", length, (unsigned)size);
+        updateStatus = "Failed: size mismatch";
+        updateInProgress = false;
+        http.end();
+        return false;
+    }
+
+    bool ok = firmwareBegin(size, sha256);
+    WiFiClient *stream = http.getStreamPtr();
+    static uint8_t chunk[1024];
+    unsigned long lastDataMs = millis();
+
+    while (ok && firmwareWritten < size)
+    {
+        size_t available = stream->available();
+        if (available == 0)
+        {
+            if (!http.connected() || millis() - lastDataMs > UPDATE_STALL_TIMEOUT_MS)
+                break;
+            // Keep the strip animating and the log draining while waiting
+            handleLedStripDuringUpdate();
+            delay(1);
+            continue;
+        }
+
+        size_t got = stream->readBytes(chunk, min(min(available, sizeof(chunk)), size - firmwareWritten));
+        ok = firmwareWrite(chunk, got);
+        lastDataMs = millis();
+    }
+    http.end();
+
+    if (ok && firmwareWritten != size)
+    {
+        firmwareAbort();
+        snprintf(firmwareError, sizeof(firmwareError), "Download incomplete");
+        ok = false;
+    }
+
+    if (!ok || !firmwareEnd())
+    {
+        LOG_E("UPD", "Update failed: %s", firmwareError);
+        updateStatus = String("Failed: ") + firmwareError;
+        updateInProgress = false;
+        return false;
+    }
+
+    LOG_I("UPD", "Update successful");
+    updateStatus = "Update successful";
+    logFlushAll();
+    ESP.restart();
+    return true;
+}
+
 void handleAutoUpdate()
 {
     // Periodic update check
     if (autoUpdateEnabled && !updateInProgress &&
-        (millis() - lastUpdateCheck) > UPDATE_CHECK_INTERVAL)
+        (millis() - lastUpdateCheck) > updateCheckInterval)
     {
         lastUpdateCheck = millis();
+        updateCheckInterval = UPDATE_CHECK_INTERVAL + random(UPDATE_CHECK_JITTER);
         checkForFirmwareUpdate();
     }
 }
@@ -0,0 +1,434 @@
+#include "color_kernels.h"
+#include "config.h"
+
+// Hue sections for every hue, packed r | g << 8 | b << 16. Built once from
+// the scalar code, so the SWAR conversion cannot drift from it.
+static uint32_t hueWheel[256];
+
+static const uint32_t EVEN_BYTES = 0x00FF00FF;
+static const uint32_t ODD_BYTES = 0xFF00FF00;
+static const uint32_t LOW_SEVEN = 0x7F7F7F7F;
+static const uint32_t HIGH_BITS = 0x80808080;
+
+// ---- Scalar ------------------------------------------------------------
+
+static inline uint8_t scaleByte(uint8_t value, uint8_t scale)
+{
+    return ((uint16_t)value * (1 + scale)) >> 8;
+}
+
+static inline uint8_t scaleByteVideo(uint8_t value, uint8_t scale)
+{
+    return (((uint16_t)value * scale) >> 8) + (value && scale ? 1 : 0);
+}
+
+static inline uint8_t blendByte(uint8_t a, uint8_t b, uint8_t amount)
+{
+    return ((uint16_t)a * (256 - amount) + (uint16_t)b * (1 + amount)) >> 8;
+}
+
+static inline uint8_t addByte(uint8_t a, uint8_t b)
+{
+    uint16_t sum = a + b;
+    return sum > 255 ? 255 : sum;
+}
+
+// hsv2rgb_rainbow: eight 32-step sections, yellow boosted
+static void hueSection(uint8_t hue, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    uint8_t offset8 = (hue & 0x1F) << 3;
+    uint8_t third = scaleByte(offset8, 256 / 3);
+    uint8_t twoThirds = scaleByte(offset8, (256 * 2) / 3);
+
+    switch (hue >> 5)
+    {
+    case 0: // Red -> orange
+        r = 255 - third, g = third, b = 0;
+        break;
+    case 1: // Orange -> yellow
+        r = 171, g = 85 + third, b = 0;
+        break;
+    case 2: // Yellow -> green
+        r = 171 - twoThirds, g = 170 + third, b = 0;
+        break;
+    case 3: // Green -> aqua
+        r = 0, g = 255 - third, b = third;
+        break;
+    case 4: // Aqua -> blue
+        r = 0, g = 171 - twoThirds, b = 85 + twoThirds;
+        break;
+    case 5: // Blue -> purple
+        r = third, g = 0, b = 255 - third;
+        break;
+    case 6: // Purple -> pink
+        r = 85 + third, g = 0, b = 171 - third;
+        break;
+    default: // Pink -> red
+        r = 170 + third, g = 0, b = 85 - third;
+        break;
+    }
+}
+
+static CRGB hsvPixel(uint8_t hue, uint8_t sat, uint8_t val)
+{
+    uint8_t r, g, b;
+    hueSection(hue, r, g, b);
+
+    // Desaturate toward white, then dim
+    if (sat == 0)
+    {
+        r = g = b = 255;
+    }
+    else if (sat != 255)
+    {
+        uint8_t desat = scaleByteVideo(255 - sat, 255 - sat);
+        uint8_t satScale = 255 - desat;
+        r = scaleByte(r, satScale) + desat;
+        g = scaleByte(g, satScale) + desat;
+        b = scaleByte(b, satScale) + desat;
+    }
+    if (val != 255)
+    {
+        val = scaleByteVideo(val, val);
+        r = val ? scaleByte(r, val) : 0;
+        g = val ? scaleByte(g, val) : 0;
+        b = val ? scaleByte(b, val) : 0;
+    }
+    return CRGB(r, g, b);
+}
+
+void hsvToRgbSpanScalar(const CHSV *in, CRGB *out, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        out[i] = hsvPixel(in[i].hue, in[i].sat, in[i].val);
+    }
+}
+
+void rainbowSpanScalar(CRGB *out, uint16_t count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val)
+{
+    for (uint16_t i = 0; i < count; i++, hue += step)
+    {
+        out[i] = hsvPixel(hue, sat, val);
+    }
+}
+
+void scaleSpanScalar(CRGB *pixels, uint16_t count, uint8_t scale)
+{
+    uint8_t *bytes = pixels->raw;
+    for (size_t i = 0; i < count * 3; i++)
+    {
+        bytes[i] = scaleByte(bytes[i], scale);
+    }
+}
+
+void blendSpanScalar(const CRGB *from, const CRGB *to, CRGB *out, uint16_t count, uint8_t amount)
+{
+    for (size_t i = 0; i < count * 3; i++)
+    {
+        out->raw[i] = blendByte(from->raw[i], to->raw[i], amount);
+    }
+}
+
+void addSpanScalar(CRGB *pixels, const CRGB *add, uint16_t count)
+{
+    for (size_t i = 0; i < count * 3; i++)
+    {
+        pixels->raw[i] = addByte(pixels->raw[i], add->raw[i]);
+    }
+}
+
+// ---- SWAR --------------------------------------------------------------
+// Even and odd bytes are split into 16-bit lanes, so one multiply scales
+// two channels. Every lane result stays below 65536 (a * (256 - amt) +
+// b * (1 + amt) is at most 255 * 257), so lanes never carry into each other.
+
+static inline uint32_t scaleWord(uint32_t word, uint16_t scalePlusOne)
+{
+    uint32_t even = ((word & EVEN_BYTES) * scalePlusOne >> 8) & EVEN_BYTES;
+    uint32_t odd = (((word >> 8) & EVEN_BYTES) * scalePlusOne) & ODD_BYTES;
+    return even | odd;
+}
+
+static inline uint32_t blendWord(uint32_t a, uint32_t b, uint16_t weightA, uint16_t weightB)
+{
+    uint32_t even = (((a & EVEN_BYTES) * weightA + (b & EVEN_BYTES) * weightB) >> 8) & EVEN_BYTES;
+    uint32_t odd = (((a >> 8) & EVEN_BYTES) * weightA + ((b >> 8) & EVEN_BYTES) * weightB) & ODD_BYTES;
+    return even | odd;
+}
+
+// Per-byte saturating add: 7-bit sums, then the carry out of each byte
+// becomes a 0xFF mask
+static inline uint32_t addWord(uint32_t a, uint32_t b)
+{
+    uint32_t sum = ((a & LOW_SEVEN) + (b & LOW_SEVEN)) ^ ((a ^ b) & HIGH_BITS);
+    uint32_t carry = ((a & b) | ((a | b) & ~sum)) & HIGH_BITS;
+    return sum | ((carry >> 7) * 0xFF);
+}
+
+// Bytes before the first word boundary, handled one at a time
+static inline size_t leadingBytes(const void *data, size_t length)
+{
+    return min((size_t)(-(uintptr_t)data & 3), length);
+}
+
+static inline uint32_t loadWord(const uint8_t *data)
+{
+    uint32_t word;
+    memcpy(&word, __builtin_assume_aligned(data, 4), 4);
+    return word;
+}
+
+static inline void storeWord(uint8_t *data, uint32_t word)
+{
+    memcpy(__builtin_assume_aligned(data, 4), &word, 4);
+}
+
+void scaleSpanSwar(CRGB *pixels, uint16_t count, uint8_t scale)
+{
+    uint8_t *bytes = pixels->raw;
+    size_t length = count * 3;
+    size_t i = leadingBytes(bytes, length);
+    for (size_t j = 0; j < i; j++)
+        bytes[j] = scaleByte(bytes[j], scale);
+
+    for (; i + 4 <= length; i += 4)
+        storeWord(bytes + i, scaleWord(loadWord(bytes + i), scale + 1));
+
+    for (; i < length; i++)
+        bytes[i] = scaleByte(bytes[i], scale);
+}
+
+void blendSpanSwar(const CRGB *from, const CRGB *to, CRGB *out, uint16_t count, uint8_t amount)
+{
+    const uint8_t *a = from->raw;
+    const uint8_t *b = to->raw;
+    uint8_t *o = out->raw;
+    size_t length = count * 3;
+
+    // Words only line up when all three buffers share an alignment
+    size_t head = leadingBytes(o, length);
+    if (head != leadingBytes(a, length) || head != leadingBytes(b, length))
+    {
+        blendSpanScalar(from, to, out, count, amount);
+        return;
+    }
+
+    size_t i = 0;
+    for (; i < head; i++)
+        o[i] = blendByte(a[i], b[i], amount);
+
+    uint16_t weightA = 256 - amount;
+    uint16_t weightB = 1 + amount;
+    for (; i + 4 <= length; i += 4)
+        storeWord(o + i, blendWord(loadWord(a + i), loadWord(b + i), weightA, weightB));
+
+    for (; i < length; i++)
+        o[i] = blendByte(a[i], b[i], amount);
+}
+
+void addSpanSwar(CRGB *pixels, const CRGB *add, uint16_t count)
+{
+    uint8_t *a = pixels->raw;
+    const uint8_t *b = add->raw;
+    size_t length = count * 3;
+
+    size_t head = leadingBytes(a, length);
+    if (head != leadingBytes(b, length))
+    {
+        addSpanScalar(pixels, add, count);
+        return;
+    }
+
+    size_t i = 0;
+    for (; i < head; i++)
+        a[i] = addByte(a[i], b[i]);
+
+    for (; i + 4 <= length; i += 4)
+        storeWord(a + i, addWord(loadWord(a + i), loadWord(b + i)));
+
+    for (; i < length; i++)
+        a[i] = addByte(a[i], b[i]);
+}
+
+// Hue from the table, then saturation and value as two packed scales
+static inline uint32_t hsvWord(uint8_t hue, uint8_t sat, uint8_t val)
+{
+    uint32_t rgb = hueWheel[hue];
+    if (sat == 0)
+    {
+        rgb = 0xFFFFFF;
+    }
+    else if (sat != 255)
+    {
+        uint8_t desat = scaleByteVideo(255 - sat, 255 - sat);
+        rgb = scaleWord(rgb, 256 - desat) + desat * 0x010101;
+    }
+    if (val != 255)
+    {
+        val = scaleByteVideo(val, val);
+        rgb = val ? scaleWord(rgb, val + 1) : 0;
+    }
+    return rgb;
+}
+
+static inline void storePixel(CRGB &pixel, uint32_t rgb)
+{
+    pixel.r = rgb;
+    pixel.g = rgb >> 8;
+    pixel.b = rgb >> 16;
+}
+
+void hsvToRgbSpanSwar(const CHSV *in, CRGB *out, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        storePixel(out[i], hsvWord(in[i].hue, in[i].sat, in[i].val));
+    }
+}
+
+// Saturation and value are shared by the whole span, so their factors are
+// worked out once and each pixel is a table load and at most two scales
+void rainbowSpanSwar(CRGB *out, uint16_t count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val)
+{
+    uint8_t desat = sat == 255 ? 0 : scaleByteVideo(255 - sat, 255 - sat);
+    uint8_t dimmed = val == 255 ? 255 : scaleByteVideo(val, val);
+    if (sat == 0 || dimmed == 0)
+    {
+        // Hue plays no part, every pixel is the same gray
+        CRGB gray;
+        storePixel(gray, hsvWord(0, sat, val));
+        fill_solid(out, count, gray);
+        return;
+    }
+
+    for (uint16_t i = 0; i < count; i++, hue += step)
+    {
+        uint32_t rgb = hueWheel[hue];
+        if (sat != 255)
+            rgb = scaleWord(rgb, 256 - desat) + desat * 0x010101;
+        if (val != 255)
+            rgb = scaleWord(rgb, dimmed + 1);
+        storePixel(out[i], rgb);
+    }
+}
+
+// ---- Selected versions ---------------------------------------------------
+
+void initializeColorKernels()
+{
+    for (uint16_t hue = 0; hue < 256; hue++)
+    {
+        uint8_t r, g, b;
+        hueSection(hue, r, g, b);
+        hueWheel[hue] = r | (g << 8) | ((uint32_t)b << 16);
+    }
+}
+
+void hsvToRgbSpan(const CHSV *in, CRGB *out, uint16_t count)
+{
+#if COLOR_KERNELS_SWAR
+    hsvToRgbSpanSwar(in, out, count);
+#else
+    hsvToRgbSpanScalar(in, out, count);
+#endif
+}
+
+void rainbowSpan(CRGB *out, uint16_t count, uint8_t hue, uint8_t step, uint8_t sat, uint8_t val)
+{
+#if COLOR_KERNELS_SWAR
+    rainbowSpanSwar(out, count, hue, step, sat, val);
+#else
+    rainbowSpanScalar(out, count, hue, step, sat, val);
+#endif
+}
+
+void blendSpan(const CRGB *from, const CRGB *to, CRGB *out, uint16_t count, uint8_t amount)
+{
+#if COLOR_KERNELS_SWAR
+    blendSpanSwar(from, to, out, count, amount);
+#else
+    blendSpanScalar(from, to, out, count, amount);
+#endif
+}
+
+CRGB hsvToRgb(const CHSV &hsv)
+{
+    CRGB rgb;
+    hsvToRgbSpan(&hsv, &rgb, 1);
+    return rgb;
+}
+
+// ---- Benchmark -----------------------------------------------------------
+
+static const uint16_t BENCH_PIXELS = 300;
+static const uint8_t BENCH_ROUNDS = 20;
+
+static CRGB benchA[BENCH_PIXELS];
+static CRGB benchB[BENCH_PIXELS];
+static CRGB benchScalar[BENCH_PIXELS];
+static CRGB benchSwar[BENCH_PIXELS];
+static CHSV benchHsv[BENCH_PIXELS];
+
+static uint32_t nsPerPixel(uint32_t elapsedUs)
+{
+    return (uint64_t)elapsedUs * 1000 / (BENCH_ROUNDS * BENCH_PIXELS);
+}
+
+// Runs one kernel over the same inputs in both versions. Each round starts
+// from benchA, so in-place kernels see the same data every time.
+template <typename Kernel>
+static void benchKernel(KernelBenchResult &result, const char *name, Kernel scalar, Kernel swar)
+{
+    result.name = name;
+    uint32_t start = micros();
+    for (uint8_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        memcpy(benchScalar, benchA, sizeof(benchA));
+        scalar(benchScalar);
+    }
+    result.scalarNs = nsPerPixel(micros() - start);
+
+    start = micros();
+    for (uint8_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        memcpy(benchSwar, benchA, sizeof(benchA));
+        swar(benchSwar);
+    }
+    result.swarNs = nsPerPixel(micros() - start);
+    result.exact = memcmp(benchScalar, benchSwar, sizeof(benchScalar)) == 0;
+}
+
+uint8_t benchmarkColorKernels(KernelBenchResult *results)
+{
+    // Deterministic pseudo-random inputs, covering saturated and clipped values
+    uint32_t seed = 0x2545F491;
+    for (uint16_t i = 0; i < BENCH_PIXELS; i++)
+    {
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            benchA[i].raw[c] = seed >> 24;
+            benchB[i].raw[c] = seed >> 16;
+            benchHsv[i].raw[c] = seed >> 8;
+        }
+    }
+
+    typedef void (*Kernel)(CRGB *);
+    benchKernel<Kernel>(results[0], "hsv",
+                        [](CRGB *out) { hsvToRgbSpanScalar(benchHsv, out, BENCH_PIXELS); },
+                        [](CRGB *out) { hsvToRgbSpanSwar(benchHsv, out, BENCH_PIXELS); });
+    benchKernel<Kernel>(results[1], "rainbow",
+                        [](CRGB *out) { rainbowSpanScalar(out, BENCH_PIXELS, 17, 3, 240, 200); },
+                        [](CRGB *out) { rainbowSpanSwar(out, BENCH_PIXELS, 17, 3, 240, 200); });
+    benchKernel<Kernel>(results[2], "scale",
+                        [](CRGB *out) { scaleSpanScalar(out, BENCH_PIXELS, 173); },
+                        [](CRGB *out) { scaleSpanSwar(out, BENCH_PIXELS, 173); });
+    benchKernel<Kernel>(results[3], "blend",
+                        [](CRGB *out) { blendSpanScalar(out, benchB, out, BENCH_PIXELS, 91); },
+                        [](CRGB *out) { blendSpanSwar(out, benchB, out, BENCH_PIXELS, 91); });
+    benchKernel<Kernel>(results[4], "add",
+                        [](CRGB *out) { addSpanScalar(out, benchB, BENCH_PIXELS); },
+                        [](CRGB *out) { addSpanSwar(out, benchB, BENCH_PIXELS); });
+    return COLOR_KERNEL_COUNT;
+}
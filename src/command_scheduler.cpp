@@ -0,0 +1,108 @@
+#include "command_scheduler.h"
+#include "config.h"
+#include "serial_control.h"
+#include "time_sync.h"
+#include "logger.h"
+
+struct ScheduledCommand
+{
+    bool used;
+    bool isState; // Staged strip state (HTTP) rather than a command line
+    uint32_t atMs;
+    String command;
+    StripState state;
+};
+
+static ScheduledCommand slots[SCHEDULE_SLOTS];
+
+static ScheduledCommand *freeSlot()
+{
+    for (int i = 0; i < SCHEDULE_SLOTS; i++)
+    {
+        if (!slots[i].used)
+            return &slots[i];
+    }
+    return nullptr;
+}
+
+bool scheduleCommand(uint32_t atMs, const String &command)
+{
+    ScheduledCommand *slot = freeSlot();
+    if (!slot)
+        return false;
+
+    slot->used = true;
+    slot->isState = false;
+    slot->atMs = atMs;
+    slot->command = command;
+    return true;
+}
+
+bool scheduleState(uint32_t atMs, const StripState &state)
+{
+    ScheduledCommand *slot = freeSlot();
+    if (!slot)
+        return false;
+
+    slot->used = true;
+    slot->isState = true;
+    slot->atMs = atMs;
+    slot->state = state;
+    return true;
+}
+
+void runScheduledCommands()
+{
+    uint32_t now = syncedMillis();
+
+    // Run everything that is due, earliest first
+    while (true)
+    {
+        ScheduledCommand *due = nullptr;
+        for (int i = 0; i < SCHEDULE_SLOTS; i++)
+        {
+            ScheduledCommand &slot = slots[i];
+            if (slot.used && (int32_t)(now - slot.atMs) >= 0 &&
+                (!due || (int32_t)(slot.atMs - due->atMs) < 0))
+            {
+                due = &slot;
+            }
+        }
+        if (!due)
+            return;
+
+        // Free the slot before running, the command may schedule another
+        due->used = false;
+        LOG_D("SCHED", "Running command scheduled for %u (now %u)", (unsigned)due->atMs, (unsigned)now);
+        if (due->isState)
+        {
+            stageState(due->state);
+        }
+        else
+        {
+            String command = due->command;
+            due->command = "";
+            runScheduledCommand(command);
+        }
+    }
+}
+
+void clearScheduledCommands()
+{
+    for (int i = 0; i < SCHEDULE_SLOTS; i++)
+    {
+        slots[i].used = false;
+        slots[i].command = "";
+    }
+}
+
+int scheduledCommandCount()
+{
+    int count = 0;
+    for (int i = 0; i < SCHEDULE_SLOTS; i++)
+    {
+        if (slots[i].used)
+            count++;
+    }
+    return count;
+}
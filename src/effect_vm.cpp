@@ -0,0 +1,557 @@
+#include "effect_vm.h"
+#include "led_control.h"
+#include "logger.h"
+#include "pixel_map.h"
+#include "color_kernels.h"
+#include <LittleFS.h>
+
+// Effect VM State Variables
+VmProgram vmProgram = {};
+String vmSource = "";
+
+enum VmOp : uint8_t
+{
+    OP_MOV,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_NEG,
+    OP_LT,
+    OP_GT,
+    OP_SIN,
+    OP_COS,
+    OP_TRI,
+    OP_ABS,
+    OP_MIN,
+    OP_MAX,
+    OP_CLAMP,
+    OP_FLOOR,
+    OP_FRAC
+};
+
+// Register layout: per-frame inputs, the per-pixel index, three outputs, then
+// constants growing up and expression temporaries growing down
+static const uint8_t REG_INDEX = 0; // i, pixel index
+static const uint8_t REG_X = 1;     // x, i / n
+static const uint8_t REG_TIME = 2;  // t, seconds scaled by effect speed
+static const uint8_t REG_BEAT = 3;  // beat, 0-1
+static const uint8_t REG_BAND0 = 4; // b0..b7, 0-1
+static const uint8_t REG_COUNT = 12; // n, LED count
+static const uint8_t REG_PHASE = 13; // phase, predicted position in the beat, 0-1
+static const uint8_t REG_OUT0 = 14; // h/r, s/g, v/b
+static const uint8_t REG_FIRST_FREE = 17;
+static const int32_t FIXED_ONE = 65536;
+
+static int32_t registers[VM_REGISTERS];
+static CHSV hsvOut[NUM_LEDS]; // HSV programs convert the whole frame in one span
+static VmProgram stagedProgram;
+
+// ---- Compiler ----------------------------------------------------------
+// program := (name '=' expr [';'])+
+// expr    := sum (('<' | '>') sum)*
+// sum     := term (('+' | '-') term)*
+// term    := unary (('*' | '/' | '%') unary)*
+// unary   := '-' unary | number | name | name '(' expr [',' expr] ')' | '(' expr ')'
+
+struct Compiler
+{
+    const char *start;
+    const char *pos;
+    VmProgram *program;
+    uint8_t nextTemp;
+    uint8_t lowestTemp; // Lowest register any temp has used - constants stay below it
+    bool usesHsv;
+    char *error;
+    size_t errorSize;
+    bool failed;
+};
+
+struct VmFunction
+{
+    const char *name;
+    uint8_t op;
+    uint8_t arguments;
+};
+
+static const VmFunction VM_FUNCTIONS[] = {
+    {"sin", OP_SIN, 1}, {"cos", OP_COS, 1}, {"tri", OP_TRI, 1}, {"abs", OP_ABS, 1},
+    {"clamp", OP_CLAMP, 1}, {"floor", OP_FLOOR, 1}, {"frac", OP_FRAC, 1},
+    {"min", OP_MIN, 2}, {"max", OP_MAX, 2}};
+
+static uint8_t compileError(Compiler &c, const char *message)
+{
+    if (!c.failed)
+        snprintf(c.error, c.errorSize, "col %d: %s", (int)(c.pos - c.start) + 1, message);
+    c.failed = true;
+    return REG_INDEX;
+}
+
+static void skipSpace(Compiler &c)
+{
+    while (*c.pos == ' ' || *c.pos == '\t' || *c.pos == '\n' || *c.pos == '\r')
+        c.pos++;
+}
+
+static bool accept(Compiler &c, char expected)
+{
+    skipSpace(c);
+    if (*c.pos != expected)
+        return false;
+    c.pos++;
+    return true;
+}
+
+static int readName(Compiler &c, char *name, size_t size)
+{
+    skipSpace(c);
+    size_t length = 0;
+    while (isalnum(c.pos[length]) || c.pos[length] == '_')
+        length++;
+    if (length == 0 || length >= size || isdigit(c.pos[0]))
+        return 0;
+    memcpy(name, c.pos, length);
+    name[length] = '\0';
+    c.pos += length;
+    return length;
+}
+
+static bool isTemp(Compiler &c, uint8_t reg)
+{
+    return reg > c.nextTemp;
+}
+
+static uint8_t allocTemp(Compiler &c)
+{
+    if (c.nextTemp < c.program->constantBase + c.program->constantCount)
+        return compileError(c, "expression too complex");
+    c.lowestTemp = min(c.lowestTemp, c.nextTemp);
+    return c.nextTemp--;
+}
+
+static void freeTemp(Compiler &c, uint8_t reg)
+{
+    if (reg == c.nextTemp + 1)
+        c.nextTemp++;
+}
+
+static uint8_t emit(Compiler &c, uint8_t op, uint8_t a, uint8_t b)
+{
+    // Operands are released first so the result can reuse their register
+    if (isTemp(c, b) && b != a)
+        freeTemp(c, b);
+    if (isTemp(c, a))
+        freeTemp(c, a);
+
+    uint8_t dst = allocTemp(c);
+    if (c.program->length >= VM_INSTRUCTION_LIMIT)
+        return compileError(c, "program too long");
+    c.program->code[c.program->length++] = {op, dst, a, b};
+    return dst;
+}
+
+static uint8_t constantRegister(Compiler &c, int32_t value)
+{
+    VmProgram &program = *c.program;
+    for (uint8_t i = 0; i < program.constantCount; i++)
+    {
+        if (program.constants[i] == value)
+            return program.constantBase + i;
+    }
+    // A register an earlier instruction used as a temp is rewritten on
+    // every pixel, so a constant there would be clobbered
+    if (program.constantBase + program.constantCount >= c.lowestTemp)
+        return compileError(c, "too many constants");
+    program.constants[program.constantCount] = value;
+    return program.constantBase + program.constantCount++;
+}
+
+static int inputRegister(const char *name)
+{
+    if (strcmp(name, "i") == 0)
+        return REG_INDEX;
+    if (strcmp(name, "x") == 0)
+        return REG_X;
+    if (strcmp(name, "t") == 0)
+        return REG_TIME;
+    if (strcmp(name, "beat") == 0)
+        return REG_BEAT;
+    if (strcmp(name, "n") == 0)
+        return REG_COUNT;
+    if (strcmp(name, "phase") == 0)
+        return REG_PHASE;
+    if (name[0] == 'b' && name[1] >= '0' && name[1] < '0' + MUSIC_BANDS && name[2] == '\0')
+        return REG_BAND0 + name[1] - '0';
+    return -1;
+}
+
+static int outputRegister(const char *name, bool &hsv)
+{
+    static const char *HSV_NAMES = "hsv";
+    static const char *RGB_NAMES = "rgb";
+    if (name[0] == '\0' || name[1] != '\0')
+        return -1;
+    const char *found = strchr(HSV_NAMES, name[0]);
+    hsv = found != nullptr;
+    if (found)
+        return REG_OUT0 + (found - HSV_NAMES);
+    found = strchr(RGB_NAMES, name[0]);
+    return found ? REG_OUT0 + (found - RGB_NAMES) : -1;
+}
+
+static uint8_t parseExpression(Compiler &c);
+
+static uint8_t parseUnary(Compiler &c)
+{
+    skipSpace(c);
+    if (accept(c, '-'))
+        return emit(c, OP_NEG, parseUnary(c), 0);
+
+    if (accept(c, '('))
+    {
+        uint8_t reg = parseExpression(c);
+        if (!accept(c, ')'))
+            return compileError(c, "expected )");
+        return reg;
+    }
+
+    if (isdigit(*c.pos) || *c.pos == '.')
+    {
+        char *end;
+        double value = strtod(c.pos, &end);
+        c.pos = end;
+        if (value > 32767 || value < -32768)
+            return compileError(c, "number out of range");
+        return constantRegister(c, (int32_t)(value * FIXED_ONE));
+    }
+
+    char name[8];
+    if (!readName(c, name, sizeof(name)))
+        return compileError(c, "expected a value");
+
+    if (accept(c, '('))
+    {
+        for (const VmFunction &function : VM_FUNCTIONS)
+        {
+            if (strcmp(name, function.name) != 0)
+                continue;
+            uint8_t a = parseExpression(c);
+            uint8_t b = 0;
+            if (function.arguments == 2)
+            {
+                if (!accept(c, ','))
+                    return compileError(c, "expected ,");
+                b = parseExpression(c);
+            }
+            if (!accept(c, ')'))
+                return compileError(c, "expected )");
+            return emit(c, function.op, a, b);
+        }
+        return compileError(c, "unknown function");
+    }
+
+    bool hsv;
+    int reg = inputRegister(name);
+    if (reg < 0)
+        reg = outputRegister(name, hsv);
+    if (reg < 0)
+        return compileError(c, "unknown name");
+    return reg;
+}
+
+static uint8_t parseTerm(Compiler &c)
+{
+    uint8_t reg = parseUnary(c);
+    while (!c.failed)
+    {
+        if (accept(c, '*'))
+            reg = emit(c, OP_MUL, reg, parseUnary(c));
+        else if (accept(c, '/'))
+            reg = emit(c, OP_DIV, reg, parseUnary(c));
+        else if (accept(c, '%'))
+            reg = emit(c, OP_MOD, reg, parseUnary(c));
+        else
+            break;
+    }
+    return reg;
+}
+
+static uint8_t parseSum(Compiler &c)
+{
+    uint8_t reg = parseTerm(c);
+    while (!c.failed)
+    {
+        if (accept(c, '+'))
+            reg = emit(c, OP_ADD, reg, parseTerm(c));
+        else if (accept(c, '-'))
+            reg = emit(c, OP_SUB, reg, parseTerm(c));
+        else
+            break;
+    }
+    return reg;
+}
+
+static uint8_t parseExpression(Compiler &c)
+{
+    uint8_t reg = parseSum(c);
+    while (!c.failed)
+    {
+        if (accept(c, '<'))
+            reg = emit(c, OP_LT, reg, parseSum(c));
+        else if (accept(c, '>'))
+            reg = emit(c, OP_GT, reg, parseSum(c));
+        else
+            break;
+    }
+    return reg;
+}
+
+static void parseStatement(Compiler &c)
+{
+    char name[8];
+    bool hsv = false;
+    int out = readName(c, name, sizeof(name)) ? outputRegister(name, hsv) : -1;
+    if (out < 0)
+    {
+        compileError(c, "expected h, s, v, r, g or b");
+        return;
+    }
+    if (hsv ? c.program->rgb : c.usesHsv)
+    {
+        compileError(c, "cannot mix h/s/v with r/g/b");
+        return;
+    }
+    c.usesHsv |= hsv;
+    c.program->rgb |= !hsv;
+
+    if (!accept(c, '='))
+    {
+        compileError(c, "expected =");
+        return;
+    }
+    uint8_t reg = parseExpression(c);
+    if (c.failed)
+        return;
+
+    // Retarget the instruction that produced the value instead of copying it
+    VmProgram &program = *c.program;
+    if (isTemp(c, reg) && program.length > 0 && program.code[program.length - 1].dst == reg)
+    {
+        program.code[program.length - 1].dst = out;
+        freeTemp(c, reg);
+    }
+    else
+    {
+        if (isTemp(c, reg))
+            freeTemp(c, reg);
+        if (program.length >= VM_INSTRUCTION_LIMIT)
+        {
+            compileError(c, "program too long");
+            return;
+        }
+        program.code[program.length++] = {OP_MOV, (uint8_t)out, reg, 0};
+    }
+    accept(c, ';');
+}
+
+bool vmCompile(const char *source, VmProgram &program, char *error, size_t errorSize)
+{
+    program = {};
+    program.constantBase = REG_FIRST_FREE;
+    Compiler c = {source, source, &program, VM_REGISTERS - 1, VM_REGISTERS, false, error, errorSize, false};
+
+    skipSpace(c);
+    if (*c.pos == '\0')
+        compileError(c, "empty program");
+    while (!c.failed && *c.pos != '\0')
+    {
+        parseStatement(c);
+        skipSpace(c);
+    }
+    return !c.failed;
+}
+
+// ---- Interpreter -------------------------------------------------------
+
+static inline int32_t toByte(int32_t value)
+{
+    return constrain(value, 0, FIXED_ONE - 1) >> 8;
+}
+
+static inline void runProgram(const VmInstruction *code, const VmInstruction *end, int32_t *reg)
+{
+    for (const VmInstruction *ins = code; ins < end; ins++)
+    {
+        int32_t a = reg[ins->a];
+        int32_t b = reg[ins->b];
+        int32_t result;
+        switch (ins->op)
+        {
+        case OP_MOV:
+            result = a;
+            break;
+        case OP_ADD:
+            result = a + b;
+            break;
+        case OP_SUB:
+            result = a - b;
+            break;
+        case OP_MUL:
+            result = ((int64_t)a * b) >> 16;
+            break;
+        case OP_DIV:
+            result = b != 0 ? (int32_t)(((int64_t)a << 16) / b) : 0;
+            break;
+        case OP_MOD:
+            // INT32_MIN % -1 overflows (SIGFPE on x86), and x % -1 is 0 anyway
+            result = b != 0 && b != -1 ? a % b : 0;
+            break;
+        case OP_NEG:
+            result = -a;
+            break;
+        case OP_LT:
+            result = a < b ? FIXED_ONE : 0;
+            break;
+        case OP_GT:
+            result = a > b ? FIXED_ONE : 0;
+            break;
+        case OP_SIN:
+            // Period 1: sin(0.25) = 1
+            result = sin16((uint16_t)a) * 2;
+            break;
+        case OP_COS:
+            result = cos16((uint16_t)a) * 2;
+            break;
+        case OP_TRI:
+            result = FIXED_ONE - abs(2 * (a & 0xFFFF) - FIXED_ONE);
+            break;
+        case OP_ABS:
+            result = abs(a);
+            break;
+        case OP_MIN:
+            result = min(a, b);
+            break;
+        case OP_MAX:
+            result = max(a, b);
+            break;
+        case OP_CLAMP:
+            result = constrain(a, 0, FIXED_ONE);
+            break;
+        case OP_FLOOR:
+            result = a & ~0xFFFF;
+            break;
+        default: // OP_FRAC
+            result = a & 0xFFFF;
+            break;
+        }
+        reg[ins->dst] = result;
+    }
+}
+
+void vmRenderEffect(CRGB *out, uint32_t timeMs, const MusicFrame &music, uint16_t phase)
+{
+    const VmProgram &program = vmProgram;
+    if (program.length == 0)
+    {
+        fill_solid(out, NUM_LEDS, CRGB::Black);
+        return;
+    }
+
+    // Everything except i and x is fixed for the whole frame
+    int32_t *reg = registers;
+    memcpy(reg + program.constantBase, program.constants, program.constantCount * sizeof(int32_t));
+    reg[REG_TIME] = (int64_t)timeMs * FIXED_ONE / 1000;
+    reg[REG_BEAT] = music.beat * FIXED_ONE / 100;
+    for (uint8_t band = 0; band < MUSIC_BANDS; band++)
+    {
+        reg[REG_BAND0 + band] = band < music.bandCount ? music.bands[band] * FIXED_ONE / 100 : 0;
+    }
+    reg[REG_COUNT] = NUM_LEDS * FIXED_ONE;
+    reg[REG_PHASE] = phase;
+    reg[REG_OUT0] = 0;
+    reg[REG_OUT0 + 1] = program.rgb ? 0 : FIXED_ONE;
+    reg[REG_OUT0 + 2] = program.rgb ? 0 : FIXED_ONE;
+
+    const VmInstruction *code = program.code;
+    const VmInstruction *end = code + program.length;
+    int32_t xStep = FIXED_ONE / NUM_LEDS;
+
+    // Output format is chosen once per frame, not per pixel
+    if (program.rgb)
+    {
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            reg[REG_INDEX] = i * FIXED_ONE;
+            reg[REG_X] = i * xStep;
+            runProgram(code, end, reg);
+            out[i] = CRGB(toByte(reg[REG_OUT0]), toByte(reg[REG_OUT0 + 1]), toByte(reg[REG_OUT0 + 2]));
+        }
+    }
+    else
+    {
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            reg[REG_INDEX] = i * FIXED_ONE;
+            reg[REG_X] = i * xStep;
+            runProgram(code, end, reg);
+            hsvOut[i] = CHSV(reg[REG_OUT0] >> 8, toByte(reg[REG_OUT0 + 1]), toByte(reg[REG_OUT0 + 2]));
+        }
+        hsvToRgbSpan(hsvOut, out, NUM_LEDS);
+    }
+}
+
+bool vmLoadProgram(const String &source, char *error, size_t errorSize)
+{
+    if (source.length() > VM_SOURCE_MAX)
+    {
+        snprintf(error, errorSize, "program longer than %d characters", VM_SOURCE_MAX);
+        return false;
+    }
+    if (!vmCompile(source.c_str(), stagedProgram, error, errorSize))
+        return false;
+
+    vmProgram = stagedProgram;
+    vmSource = source;
+
+    File file = LittleFS.open(VM_PROGRAM_PATH, "w");
+    if (file)
+        file.print(source);
+    file.close();
+    LOG_I("VM", "Effect program loaded: %u instructions", vmProgram.length);
+    return true;
+}
+
+void initializeEffectVm()
+{
+    // LittleFS is mounted by initializeTimeline()
+    File file = LittleFS.open(VM_PROGRAM_PATH, "r");
+    if (!file)
+        return;
+    String source = file.readString();
+    file.close();
+
+    char error[48];
+    if (vmCompile(source.c_str(), vmProgram, error, sizeof(error)))
+        vmSource = source;
+    else
+        LOG_W("VM", "Stored effect program rejected: %s", error);
+}
+
+// Renders frames into a scratch buffer and reports the cost per pixel, so a
+// program can be weighed against the built-in C++ effects. vm:bench runs it
+// on the device and host/tests/effect_vm_test in the host build.
+void vmBenchmark(uint32_t &vmNs, uint32_t &rainbowNs, uint32_t &visualizerNs)
+{
+    static const uint16_t BENCH_FRAMES = 100;
+    static CRGB benchBuffer[LED_BUFFER_SIZE];
+    MusicFrame music = {};
+    music.beat = 50;
+
+    uint32_t start = micros();
+    for (uint16_t frame = 0; frame < BENCH_FRAMES; frame++)
+        vmRenderEffect(benchBuffer, frame * FRAME_INTERVAL_MS, music, frame * 655);
+    vmNs = (uint64_t)(micros() - start) * 1000 / (BENCH_FRAMES * NUM_LEDS);
+
+    benchmarkBuiltinEffects(benchBuffer, BENCH_FRAMES, rainbowNs, visualizerNs);
+}
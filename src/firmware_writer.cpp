@@ -0,0 +1,130 @@
+#include "firmware_writer.h"
+#include "config.h"
+#include "led_control.h"
+#include "logger.h"
+#include <Update.h>
+#include <mbedtls/sha256.h>
+
+// Firmware Writer State Variables
+bool firmwareWriting = false;
+size_t firmwareWritten = 0;
+size_t firmwareSize = 0;
+char firmwareError[64] = "";
+
+// Data goes straight to Update.write(). The Updater already gathers it
+// into a sector buffer and erases and programs whole flash sectors.
+static mbedtls_sha256_context shaContext;
+static uint8_t expectedHash[32];
+static bool checkHash = false;
+static unsigned long lastProgressMs = 0;
+
+static bool fail(const char *reason)
+{
+    snprintf(firmwareError, sizeof(firmwareError), "%s", reason);
+    LOG_E("FW", "Firmware update failed: %s", firmwareError);
+    firmwareAbort();
+    return false;
+}
+
+static bool parseHash(const String &hex, uint8_t *hash)
+{
+    if (hex.length() != 64)
+        return false;
+
+    for (int i = 0; i < 32; i++)
+    {
+        char byte[3] = {hex[i * 2], hex[i * 2 + 1], '\0'};
+        char *end;
+        hash[i] = strtoul(byte, &end, 16);
+        if (*end != '\0')
+            return false;
+    }
+    return true;
+}
+
+bool firmwareBegin(size_t size, const String &expectedSha256)
+{
+    if (firmwareWriting)
+        firmwareAbort();
+
+    firmwareError[0] = '\0';
+    checkHash = expectedSha256.length() > 0;
+    if (checkHash && !parseHash(expectedSha256, expectedHash))
+    {
+        snprintf(firmwareError, sizeof(firmwareError), "Invalid sha256");
+        return false;
+    }
+
+    if (!Update.begin(size > 0 ? size : UPDATE_SIZE_UNKNOWN))
+    {
+        snprintf(firmwareError, sizeof(firmwareError), "%s", Update.errorString());
+        LOG_E("FW", "Firmware update failed: %s", firmwareError);
+        return false;
+    }
+
+    mbedtls_sha256_init(&shaContext);
+    mbedtls_sha256_starts(&shaContext, 0);
+    firmwareWritten = 0;
+    firmwareSize = size;
+    firmwareWriting = true;
+    lastProgressMs = millis();
+    LOG_I("FW", "Firmware update started (%u bytes)", (unsigned)size);
+    return true;
+}
+
+bool firmwareWrite(const uint8_t *data, size_t length)
+{
+    if (!firmwareWriting)
+        return false;
+
+    mbedtls_sha256_update(&shaContext, data, length);
+    firmwareWritten += length;
+
+    if (Update.write((uint8_t *)data, length) != length)
+        return fail(Update.errorString());
+
+    // Progress is time limited and formatted into fixed buffers only
+    if (millis() - lastProgressMs >= UPDATE_PROGRESS_INTERVAL_MS)
+    {
+        lastProgressMs = millis();
+        if (firmwareSize > 0)
+            LOG_I("FW", "Firmware progress: %u%%", (unsigned)(firmwareWritten * 100 / firmwareSize));
+        else
+            LOG_I("FW", "Firmware progress: %u KB", (unsigned)(firmwareWritten / 1024));
+    }
+
+    // The transfer blocks loop(), so keep the strip animating from here
+    handleLedStripDuringUpdate();
+    return true;
+}
+
+bool firmwareEnd()
+{
+    if (!firmwareWriting)
+        return false;
+
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&shaContext, hash);
+    mbedtls_sha256_free(&shaContext);
+
+    // Checked before Update.end() so a bad image is never marked bootable
+    if (checkHash && memcmp(hash, expectedHash, sizeof(hash)) != 0)
+        return fail("SHA-256 mismatch");
+    if (!Update.end(true))
+        return fail(Update.errorString());
+
+    firmwareWriting = false;
+    LOG_I("FW", "Firmware update complete (%u bytes)", (unsigned)firmwareWritten);
+    return true;
+}
+
+void firmwareAbort()
+{
+    if (!firmwareWriting)
+        return;
+
+    firmwareWriting = false;
+    mbedtls_sha256_free(&shaContext);
+    Update.abort();
+    LOG_W("FW", "Firmware update aborted after %u bytes", (unsigned)firmwareWritten);
+}
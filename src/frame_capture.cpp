@@ -0,0 +1,261 @@
+#include "frame_capture.h"
+#include "config.h"
+#include "frame_codec.h"
+#include "led_control.h"
+#include "logger.h"
+#include "scenes.h"
+#include <LittleFS.h>
+
+// Frame Capture State Variables
+bool captureActive = false;
+uint32_t captureFrameCount = 0;
+
+// File layout (little endian):
+//   header: "LCP1", u16 led count, u16 frame interval ms
+//   frame:  u32 time ms, u8 brightness, u8 encoding, u16 payload length, payload
+// Encoding 0 is raw r,g,b per pixel, 1 is changed runs against the previous
+// frame (see frame_codec.h), whichever is smaller.
+static const uint8_t CAPTURE_MAGIC[4] = {'L', 'C', 'P', '1'};
+static const size_t CAPTURE_HEADER_SIZE = 8;
+static const size_t FRAME_HEADER_SIZE = 8;
+static const uint8_t ENCODING_RAW = 0;
+static const uint8_t ENCODING_DELTA = 1;
+
+struct CaptureFrameHeader
+{
+    uint32_t timeMs;
+    uint8_t brightness;
+    uint8_t encoding;
+    uint16_t length;
+};
+
+static File captureFile;
+static uint32_t captureLimit = 0;
+static CRGB capturePrevious[NUM_LEDS];
+static uint8_t captureBuffer[NUM_LEDS * 3];
+
+static String goldenPath(const String &name)
+{
+    return String(CAPTURE_GOLDEN_PREFIX) + name + ".lcp";
+}
+
+bool captureStart(uint32_t frames)
+{
+    captureStop();
+    captureFile = LittleFS.open(CAPTURE_PATH, "w");
+    if (!captureFile)
+        return false;
+
+    uint8_t header[CAPTURE_HEADER_SIZE] = {CAPTURE_MAGIC[0], CAPTURE_MAGIC[1], CAPTURE_MAGIC[2], CAPTURE_MAGIC[3],
+                                           NUM_LEDS & 0xFF, NUM_LEDS >> 8,
+                                           FRAME_INTERVAL_MS & 0xFF, FRAME_INTERVAL_MS >> 8};
+    captureFile.write(header, sizeof(header));
+
+    fill_solid(capturePrevious, NUM_LEDS, CRGB::Black);
+    captureLimit = min(frames, (uint32_t)CAPTURE_MAX_FRAMES);
+    captureFrameCount = 0;
+    captureActive = true;
+
+    // Effects run from a simulated clock that advances one frame interval per
+    // rendered frame, so the capture is the same however long writes take
+    setSimulatedClock(true);
+    LOG_I("CAP", "Capturing %u frames", (unsigned)captureLimit);
+    return true;
+}
+
+void captureStop()
+{
+    if (!captureActive)
+        return;
+
+    captureActive = false;
+    captureFile.close();
+    setSimulatedClock(false);
+    LOG_I("CAP", "Capture stopped after %u frames", (unsigned)captureFrameCount);
+}
+
+void captureFrame(const CRGB *frame, uint8_t brightness, uint32_t timeMs)
+{
+    if (!captureActive)
+        return;
+
+    size_t length = encodeDeltaRuns(frame, capturePrevious, NUM_LEDS, captureBuffer, sizeof(captureBuffer));
+    uint8_t encoding = ENCODING_DELTA;
+    const uint8_t *payload = captureBuffer;
+    bool unchanged = length == 0 && memcmp(frame, capturePrevious, sizeof(capturePrevious)) == 0;
+    if (length == 0 && !unchanged)
+    {
+        // Changed runs would be larger than the frame itself
+        encoding = ENCODING_RAW;
+        payload = (const uint8_t *)frame;
+        length = NUM_LEDS * 3;
+    }
+
+    uint8_t header[FRAME_HEADER_SIZE] = {(uint8_t)timeMs, (uint8_t)(timeMs >> 8),
+                                         (uint8_t)(timeMs >> 16), (uint8_t)(timeMs >> 24),
+                                         brightness, encoding,
+                                         (uint8_t)length, (uint8_t)(length >> 8)};
+    if (captureFile.write(header, sizeof(header)) != sizeof(header) ||
+        captureFile.write(payload, length) != length)
+    {
+        LOG_W("CAP", "Capture write failed, filesystem full?");
+        captureStop();
+        return;
+    }
+
+    memcpy(capturePrevious, frame, sizeof(capturePrevious));
+    if (++captureFrameCount >= captureLimit)
+        captureStop();
+}
+
+bool captureSave(const String &name)
+{
+    if (captureActive || !isValidSceneName(name) || !LittleFS.exists(CAPTURE_PATH))
+        return false;
+
+    String path = goldenPath(name);
+    LittleFS.remove(path);
+
+    // Copied rather than renamed so the capture can still be compared
+    File source = LittleFS.open(CAPTURE_PATH, "r");
+    File golden = LittleFS.open(path, "w");
+    if (!source || !golden)
+        return false;
+
+    uint8_t chunk[256];
+    int got;
+    while ((got = source.read(chunk, sizeof(chunk))) > 0)
+    {
+        if (golden.write(chunk, got) != (size_t)got)
+        {
+            golden.close();
+            LittleFS.remove(path);
+            return false;
+        }
+    }
+    LOG_I("CAP", "Golden capture '%s' saved", name.c_str());
+    return true;
+}
+
+// Sequential decoder holding the current frame of one capture file
+struct CaptureReader
+{
+    File file;
+    CRGB frame[NUM_LEDS];
+    uint8_t payload[NUM_LEDS * 3];
+    CaptureFrameHeader header;
+};
+
+static CaptureReader actual;
+static CaptureReader golden;
+
+static bool openCapture(CaptureReader &reader, const String &path)
+{
+    reader.file = LittleFS.open(path, "r");
+    uint8_t raw[CAPTURE_HEADER_SIZE];
+    if (!reader.file || reader.file.read(raw, sizeof(raw)) != sizeof(raw) ||
+        memcmp(raw, CAPTURE_MAGIC, 4) != 0 || (raw[4] | (raw[5] << 8)) != NUM_LEDS)
+        return false;
+
+    fill_solid(reader.frame, NUM_LEDS, CRGB::Black);
+    return true;
+}
+
+// Returns false at the end of the file or on a malformed frame
+static bool readCaptureFrame(CaptureReader &reader)
+{
+    uint8_t raw[FRAME_HEADER_SIZE];
+    if (reader.file.read(raw, sizeof(raw)) != sizeof(raw))
+        return false;
+
+    CaptureFrameHeader &header = reader.header;
+    header.timeMs = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((uint32_t)raw[3] << 24);
+    header.brightness = raw[4];
+    header.encoding = raw[5];
+    header.length = raw[6] | (raw[7] << 8);
+    if (header.length > sizeof(reader.payload) ||
+        reader.file.read(reader.payload, header.length) != header.length)
+        return false;
+
+    if (header.encoding == ENCODING_RAW)
+    {
+        if (header.length != NUM_LEDS * 3)
+            return false;
+        memcpy(reader.frame, reader.payload, header.length);
+        return true;
+    }
+    return header.encoding == ENCODING_DELTA &&
+           decodeDeltaRuns(reader.payload, header.length, reader.frame, NUM_LEDS);
+}
+
+static uint8_t channelDiff(uint8_t a, uint8_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+bool captureCompare(const String &name, uint8_t tolerance, CaptureComparison &result)
+{
+    result = {};
+    if (captureActive || !isValidSceneName(name))
+        return false;
+
+    bool opened = openCapture(actual, CAPTURE_PATH) && openCapture(golden, goldenPath(name));
+    if (!opened)
+    {
+        actual.file.close();
+        golden.file.close();
+        return false;
+    }
+
+    while (true)
+    {
+        bool haveActual = readCaptureFrame(actual);
+        bool haveGolden = readCaptureFrame(golden);
+        if (!haveActual || !haveGolden)
+        {
+            result.lengthMismatch = haveActual != haveGolden;
+            break;
+        }
+        if (actual.header.timeMs != golden.header.timeMs)
+        {
+            result.lengthMismatch = true;
+            break;
+        }
+
+        // Global brightness scales every channel, so it is held to the same tolerance
+        bool mismatch = false;
+        uint8_t frameMax = channelDiff(actual.header.brightness, golden.header.brightness);
+        if (frameMax > tolerance)
+        {
+            mismatch = true;
+            if (result.mismatchedFrames == 0)
+                result.firstPixel = 0;
+        }
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            uint8_t diff = max(channelDiff(actual.frame[i].r, golden.frame[i].r),
+                               max(channelDiff(actual.frame[i].g, golden.frame[i].g),
+                                   channelDiff(actual.frame[i].b, golden.frame[i].b)));
+            if (diff > tolerance && !mismatch)
+            {
+                mismatch = true;
+                if (result.mismatchedFrames == 0)
+                    result.firstPixel = i;
+            }
+            frameMax = max(frameMax, diff);
+        }
+
+        if (mismatch)
+        {
+            if (result.mismatchedFrames == 0)
+                result.firstFrame = result.frames;
+            result.mismatchedFrames++;
+        }
+        result.maxDiff = max(result.maxDiff, frameMax);
+        result.frames++;
+    }
+
+    actual.file.close();
+    golden.file.close();
+    return true;
+}
@@ -0,0 +1,63 @@
+#include "frame_codec.h"
+
+size_t encodeDeltaRuns(const CRGB *frame, const CRGB *previous, uint16_t count,
+                       uint8_t *out, size_t capacity)
+{
+    size_t written = 0;
+    uint16_t i = 0;
+
+    while (i < count)
+    {
+        uint16_t skip = 0;
+        while (i + skip < count && frame[i + skip] == previous[i + skip])
+            skip++;
+        if (i + skip == count)
+            break;
+
+        // Long skips are split into count-0 runs
+        while (skip > 255)
+        {
+            if (written + 2 > capacity)
+                return 0;
+            out[written++] = 255;
+            out[written++] = 0;
+            skip -= 255;
+            i += 255;
+        }
+        i += skip;
+
+        uint8_t changed = 0;
+        while (i + changed < count && changed < 255 && frame[i + changed] != previous[i + changed])
+            changed++;
+
+        if (written + 2 + changed * 3 > capacity)
+            return 0;
+        out[written++] = skip;
+        out[written++] = changed;
+        memcpy(out + written, frame + i, changed * 3);
+        written += changed * 3;
+        i += changed;
+    }
+    return written;
+}
+
+bool decodeDeltaRuns(const uint8_t *data, size_t length, CRGB *frame, uint16_t count)
+{
+    size_t pos = 0;
+    uint32_t pixel = 0;
+
+    while (pos + 2 <= length)
+    {
+        uint8_t skip = data[pos++];
+        uint8_t changed = data[pos++];
+
+        pixel += skip;
+        if (pixel + changed > count || pos + changed * 3 > length)
+            return false;
+
+        memcpy(frame + pixel, data + pos, changed * 3);
+        pos += changed * 3;
+        pixel += changed;
+    }
+    return pos == length;
+}
@@ -0,0 +1,211 @@
+#include "frame_stream.h"
+#include "config.h"
+#include "frame_codec.h"
+#include "led_control.h"
+#include "logger.h"
+
+// Frame Stream State Variables
+FrameStreamStats frameStreamStats = {};
+
+enum StreamState
+{
+    STREAM_IDLE,
+    STREAM_HEADER,
+    STREAM_PAYLOAD,
+    STREAM_CHECKSUM,
+    STREAM_DISCARD, // Skipping the rest of an oversized frame
+    STREAM_RESYNC   // Dropping bytes until the next start byte or a quiet line
+};
+
+// Largest payload is a full palette plus one index per pixel
+static const size_t STREAM_PAYLOAD_MAX = max(NUM_LEDS * 3, 1 + 256 * 3 + NUM_LEDS);
+
+static StreamState state = STREAM_IDLE;
+static uint8_t header[3];
+static uint8_t payload[STREAM_PAYLOAD_MAX];
+static uint16_t payloadLength = 0;
+static size_t received = 0;
+static uint8_t checksum = 0;
+static size_t discardRemaining = 0;
+static unsigned long lastByteMs = 0;
+
+// A rejected frame never hands the line back to the text parser mid-frame:
+// pixel bytes could otherwise read as newline-terminated commands
+static void frameError(const char *reason, StreamState next)
+{
+    frameStreamStats.errors++;
+    state = next;
+    LOG_D("STRM", "Frame dropped: %s", reason);
+}
+
+static bool applyFullFrame()
+{
+    size_t pixels = payloadLength / 3;
+    if (payloadLength % 3 != 0 || pixels > NUM_LEDS)
+        return false;
+    memcpy(pixelFrame, payload, payloadLength);
+    return true;
+}
+
+static bool applyPaletteFrame()
+{
+    if (payloadLength < 1)
+        return false;
+    size_t paletteSize = payload[0] ? payload[0] : 256;
+    size_t indexStart = 1 + paletteSize * 3;
+    if (payloadLength < indexStart || payloadLength - indexStart > NUM_LEDS)
+        return false;
+
+    // Validated in full first so a bad index never leaves half a frame
+    const uint8_t *indices = payload + indexStart;
+    size_t pixels = payloadLength - indexStart;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        if (indices[i] >= paletteSize)
+            return false;
+    }
+
+    const CRGB *palette = (const CRGB *)(payload + 1);
+    for (size_t i = 0; i < pixels; i++)
+    {
+        pixelFrame[i] = palette[indices[i]];
+    }
+    return true;
+}
+
+static void applyFrame()
+{
+    bool ok = false;
+    switch (header[0])
+    {
+    case STREAM_FRAME_FULL:
+        ok = applyFullFrame();
+        break;
+    case STREAM_FRAME_DELTA:
+        // Runs land straight in pixelFrame, which holds the previous frame
+        ok = decodeDeltaRuns(payload, payloadLength, pixelFrame, NUM_LEDS);
+        frameStreamStats.deltaFrames += ok;
+        break;
+    case STREAM_FRAME_PALETTE:
+        ok = applyPaletteFrame();
+        frameStreamStats.paletteFrames += ok;
+        break;
+    }
+    if (!ok)
+    {
+        // Framing was intact, so the next byte is text or a new frame
+        frameError("malformed payload", STREAM_IDLE);
+        return;
+    }
+
+    // The renderer shows whatever pixelFrame holds at the next frame, so a
+    // burst of streamed frames coalesces to the newest one
+    if (pendingState.mode != MODE_PIXELS)
+        stageMode(MODE_PIXELS);
+    frameStreamStats.frames++;
+    frameStreamStats.bytes += payloadLength + 5;
+}
+
+void frameStreamStart()
+{
+    state = STREAM_HEADER;
+    received = 0;
+    checksum = 0;
+    lastByteMs = millis();
+    if (frameStreamStats.startMs == 0)
+        frameStreamStats.startMs = millis();
+}
+
+bool frameStreamActive()
+{
+    return state != STREAM_IDLE;
+}
+
+// Once the line has been quiet for STREAM_FRAME_TIMEOUT_MS no more of the
+// frame is coming, and the next byte is safe to treat as text
+void frameStreamCheckTimeout()
+{
+    if (state == STREAM_IDLE || millis() - lastByteMs <= STREAM_FRAME_TIMEOUT_MS)
+        return;
+    if (state == STREAM_RESYNC)
+        state = STREAM_IDLE;
+    else
+        frameError("timeout", STREAM_IDLE);
+}
+
+void frameStreamRead(Stream &input, int &budget)
+{
+    if (budget > 0)
+        lastByteMs = millis();
+
+    while (budget > 0 && state != STREAM_IDLE)
+    {
+        if (state == STREAM_RESYNC)
+        {
+            budget--;
+            if (input.read() == STREAM_START_BYTE)
+                frameStreamStart();
+        }
+        else if (state == STREAM_DISCARD)
+        {
+            size_t chunk = min((size_t)budget, min(discardRemaining, sizeof(payload)));
+            chunk = input.readBytes(payload, chunk);
+            discardRemaining -= chunk;
+            budget -= chunk;
+            if (discardRemaining == 0)
+                state = STREAM_IDLE;
+        }
+        else if (state == STREAM_HEADER)
+        {
+            header[received++] = input.read();
+            checksum += header[received - 1];
+            budget--;
+            if (received < sizeof(header))
+                continue;
+
+            payloadLength = header[1] | (header[2] << 8);
+            if (payloadLength > sizeof(payload))
+            {
+                // Skip the declared payload and checksum, then resume
+                discardRemaining = payloadLength + 1;
+                frameError("too long", STREAM_DISCARD);
+                continue;
+            }
+            received = 0;
+            state = payloadLength > 0 ? STREAM_PAYLOAD : STREAM_CHECKSUM;
+        }
+        else if (state == STREAM_PAYLOAD)
+        {
+            // Payload bytes are copied in bulk rather than one read() each
+            size_t chunk = min((size_t)budget, payloadLength - received);
+            chunk = input.readBytes(payload + received, chunk);
+            for (size_t i = 0; i < chunk; i++)
+            {
+                checksum += payload[received + i];
+            }
+            received += chunk;
+            budget -= chunk;
+            if (received == payloadLength)
+                state = STREAM_CHECKSUM;
+        }
+        else
+        {
+            uint8_t expected = input.read();
+            budget--;
+            if (expected != checksum)
+            {
+                // The length may be what was corrupted, so frame boundaries
+                // are unknown - wait for the next start byte
+                frameError("checksum", STREAM_RESYNC);
+                continue;
+            }
+            state = STREAM_IDLE;
+            applyFrame();
+        }
+    }
+}
+
+void resetFrameStreamStats()
+{
+    frameStreamStats = {};
+}
@@ -0,0 +1,121 @@
+#include "input_mailbox.h"
+#include "tempo_tracker.h"
+
+// Input Mailbox State Variables
+InputStats inputStats = {};
+
+// Inputs arrive from serial and HTTP handlers, both on the loop task, so a
+// single slot with a flag is enough - no locking needed
+static MusicFrame musicSlot;
+static bool musicSlotFull = false;
+
+bool parseMusicData(const String &data, MusicFrame &frame)
+{
+    // Single value is the beat (original format); with several values the
+    // last one is the beat and the ones before it are band energies
+    int values[MUSIC_BANDS + 1];
+    int count = 0;
+    const char *cursor = data.c_str();
+
+    while (*cursor && count < MUSIC_BANDS + 1)
+    {
+        char *end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor)
+            return false;
+        values[count++] = constrain(value, 0L, 100L);
+
+        cursor = end;
+        if (*cursor == ',')
+            cursor++;
+        else if (*cursor != '\0')
+            return false;
+    }
+    if (count == 0)
+        return false;
+
+    frame.receivedUs = micros();
+    frame.beat = values[count - 1];
+    frame.bandCount = count - 1;
+    for (int i = 0; i < frame.bandCount; i++)
+    {
+        frame.bands[i] = values[i];
+    }
+    return true;
+}
+
+void postMusicFrame(const MusicFrame &frame)
+{
+    // Onsets are timed here, before a newer frame can replace this one
+    tempoFeedMusic(frame);
+
+    // Latest wins: an update the renderer has not taken yet is replaced
+    if (musicSlotFull)
+        inputStats.coalesced++;
+    musicSlot = frame;
+    musicSlotFull = true;
+    inputStats.received++;
+}
+
+bool takeMusicFrame(MusicFrame &frame)
+{
+    if (!musicSlotFull)
+        return false;
+    frame = musicSlot;
+    musicSlotFull = false;
+    return true;
+}
+
+static uint8_t latencyBucket(uint32_t latencyUs)
+{
+    if (latencyUs < LATENCY_SUB_BUCKETS)
+        return latencyUs;
+
+    // Octave from the highest set bit, sub-bucket from the next two bits
+    uint8_t octave = 31 - __builtin_clz(latencyUs);
+    uint8_t sub = (latencyUs >> (octave - 2)) & (LATENCY_SUB_BUCKETS - 1);
+    return (octave - 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+// Largest latency that falls into a bucket
+static uint32_t bucketUpperBound(uint8_t bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS)
+        return bucket;
+
+    uint8_t octave = bucket / LATENCY_SUB_BUCKETS + 1;
+    uint32_t sub = bucket % LATENCY_SUB_BUCKETS;
+    uint64_t upper = ((uint64_t)(LATENCY_SUB_BUCKETS + sub + 1) << (octave - 2)) - 1;
+    return min(upper, (uint64_t)UINT32_MAX);
+}
+
+uint32_t latencyPercentile(uint8_t percent)
+{
+    if (inputStats.displayed == 0)
+        return 0;
+
+    uint32_t target = ((uint64_t)inputStats.displayed * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    {
+        seen += inputStats.histogram[bucket];
+        if (seen >= target)
+            return min(bucketUpperBound(bucket), inputStats.maxLatencyUs);
+    }
+    return inputStats.maxLatencyUs;
+}
+
+void recordInputLatency(uint32_t latencyUs)
+{
+    inputStats.histogram[latencyBucket(latencyUs)]++;
+    inputStats.displayed++;
+    inputStats.lastLatencyUs = latencyUs;
+    inputStats.maxLatencyUs = max(inputStats.maxLatencyUs, latencyUs);
+    inputStats.totalLatencyUs += latencyUs;
+}
+
+void resetInputStats()
+{
+    inputStats = {};
+    inputStats.startMs = millis();
+}
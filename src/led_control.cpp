@@ -1,92 +1,584 @@
 #include "led_control.h"
 #include "config.h"
-#include "ota_update.h"
+#include "timeline.h"
+#include "time_sync.h"
+#include "command_scheduler.h"
+#include "input_mailbox.h"
+#include "frame_capture.h"
+#include "pixel_map.h"
+#include "effect_vm.h"
+#include "tempo_tracker.h"
+#include "color_kernels.h"
+#include "led_output.h"
+#include "logger.h"
 
 // LED State Variables
-CRGB leds[NUM_LEDS];
+CRGB leds[LED_BUFFER_SIZE];
+CRGB pixelFrame[NUM_LEDS];
 LedMode currentMode = MODE_OFF;
 CRGB currentColor = CRGB::Blue;
+uint8_t currentBrightness = BRIGHTNESS;
+uint8_t effectSpeed = EFFECT_SPEED_DEFAULT;
 bool ledState = false;
+StripState pendingState = {MODE_OFF, CRGB::Blue, BRIGHTNESS, EFFECT_SPEED_DEFAULT};
+bool statePending = false;
+uint16_t transitionDurationMs = TRANSITION_DEFAULT_MS;
+EasingCurve transitionEasing = EASE_QUAD;
+FrameMetrics frameMetrics = {};
+
+// Effect animation phases (8.8 fixed point). They are derived from the
+// shared clock at the start of each frame, so units synced to the same master
+// animate in phase and an effect rendered twice in a transition is unaffected.
+static uint16_t rainbowHue = 0;
+static uint16_t visualizerBeat = 0;
+
+// Latest music: frame, its beat drawn by the visualizer for MUSIC_BEAT_HOLD_MS
+static MusicFrame latestMusic = {};
+static unsigned long musicBeatTime = 0;
+static bool musicBeatFresh = false;
+static uint8_t musicFlashLevel = 0;
+
+// Predicted position in the beat for this frame, 0-65535 (0 = on the beat)
+static uint16_t beatPhase = 0;
+
+// Crossfade state. The incoming effect renders into leds[], the outgoing one
+// into transitionFrom[], and the two are blended in place - no allocation.
+struct Transition
+{
+    bool active;
+    bool frozen;     // Outgoing frame is a snapshot (retargeted mid-transition)
+    bool sameEffect; // Only brightness differs, skip the outgoing render
+    StripState from;
+    unsigned long startMs;
+    uint16_t durationMs;
+};
+
+static Transition transition = {};
+static CRGB transitionFrom[LED_BUFFER_SIZE];
+
+// Frames start on FRAME_INTERVAL_MS boundaries of the shared clock
+static uint32_t frameMillis = 0;
+static uint32_t lastFrameIndex = 0;
+static bool staticFrameShown = false; // Idle strip already shows its frame
+
+// Simulated clock for captures: effects see exactly FRAME_INTERVAL_MS per
+// rendered frame from zero, whatever the real frame timing was
+static bool clockSimulated = false;
+static uint32_t simulatedFrame = 0;
+
+// Effects build HSV pixels or rows here and convert them as one span
+static CHSV hsvScratch[NUM_LEDS];
+static CRGB rowScratch[256];
+
+// Brightness of the frame being rendered. It travels to the output driver
+// with the frame, so loop() never touches FastLED's global brightness while
+// the output task may be transmitting.
+static uint8_t frameBrightness = BRIGHTNESS;
 
 void initializeLEDs()
 {
-    FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS);
-    FastLED.setBrightness(BRIGHTNESS);
-    FastLED.clear();
-    FastLED.show();
+    initializeLedOutput();
+    initializeColorKernels();
+    ledDriver->submit(leds, BRIGHTNESS);
 
     pinMode(BUILTIN_LED_PIN, OUTPUT);
     digitalWrite(BUILTIN_LED_PIN, LOW);
 }
 
-void setStripColor(CRGB color)
+void rainbowEffect(CRGB *out)
 {
-    fill_solid(leds, NUM_LEDS, color);
-    FastLED.show();
+    rainbowSpan(out, NUM_LEDS, rainbowHue >> 8, 255 / NUM_LEDS, 240, 255);
 }
 
-void rainbowEffect()
+// beatsin8(bpm, 0, 255) evaluated at frameMillis rather than millis(), so a
+// frame never depends on how long the render before it took
+static uint8_t frameBeatsin8(uint8_t bpm)
 {
-    static uint8_t hue = 0;
-    fill_rainbow(leds, NUM_LEDS, hue, 255 / NUM_LEDS);
-    FastLED.show();
-    hue += 3;
+    uint16_t beat = (frameMillis * ((uint32_t)bpm << 8) * 280) >> 16;
+    return scale8(sin8(beat >> 8), 255);
 }
 
-void musicVisualizerEffect()
+void musicVisualizerEffect(CRGB *out)
 {
+    // Flash on the most recent music: beat, otherwise run the ambient animation
+    if (musicBeatFresh && frameMillis - musicBeatTime < MUSIC_BEAT_HOLD_MS)
+    {
+        int intensity = map(musicFlashLevel, 0, 100, 50, 255);
+        fill_solid(out, NUM_LEDS, hsvToRgb(CHSV(160 + (musicFlashLevel % 60), 255, intensity)));
+        return;
+    }
+    musicBeatFresh = false;
+
     // Beautiful animated music visualizer effect
-    static uint8_t beat = 0;
     for (int i = 0; i < NUM_LEDS; i++)
     {
-        leds[i] = CHSV(beat + (i * 4), 255,
-                       beatsin8(60 + (i * 2), 0, 255));
+        hsvScratch[i] = CHSV((visualizerBeat >> 8) + (i * 4), 255,
+                             frameBeatsin8(60 + (i * 2)));
     }
-    FastLED.show();
-    beat += 2;
+    hsvToRgbSpan(hsvScratch, out, NUM_LEDS);
 }
 
-void handleLedStrip()
+// 2D effects walk the active XY table row by row. Cells without an LED write
+// to the scratch pixel, so the inner loops have no mapping branches.
+void rainbow2DEffect(CRGB *out)
 {
-    // Don't update LEDs during OTA to avoid conflicts
-    if (otaInProgress)
-        return;
+    if (!mapCoversAllLeds)
+        fill_solid(out, NUM_LEDS, CRGB::Black);
+
+    const uint16_t *cell = xyTable;
+    uint8_t step = max(1, 255 / (mapWidth + mapHeight));
+    uint8_t rowHue = rainbowHue >> 8;
+    for (uint16_t y = 0; y < mapHeight; y++, rowHue += step)
+    {
+        rainbowSpan(rowScratch, mapWidth, rowHue, step, 240, 255);
+        for (uint16_t x = 0; x < mapWidth; x++)
+        {
+            out[*cell++] = rowScratch[x];
+        }
+    }
+}
+
+void spectrumEffect(CRGB *out)
+{
+    if (!mapCoversAllLeds)
+        fill_solid(out, NUM_LEDS, CRGB::Black);
+
+    // Column heights in 1/256 rows, once per frame. Without band data every
+    // column follows the beat value. 32-bit, as grids may be up to 255 rows.
+    static int32_t columnLevel[256];
+    uint8_t bands = latestMusic.bandCount;
+    for (uint16_t x = 0; x < mapWidth; x++)
+    {
+        uint8_t value = bands > 0 ? latestMusic.bands[x * bands / mapWidth] : latestMusic.beat;
+        columnLevel[x] = value * mapHeight * 256 / 100;
+    }
 
-    switch (currentMode)
+    const uint16_t *cell = xyTable;
+    uint8_t hueStep = 96 / mapHeight;
+    for (uint16_t y = 0; y < mapHeight; y++)
+    {
+        // Green at the bottom through to red at the top, drifting slowly
+        int32_t rowBase = (mapHeight - 1 - y) * 256;
+        CRGB rowColor = hsvToRgb(CHSV((visualizerBeat >> 10) + 96 - (mapHeight - 1 - y) * hueStep, 255, 255));
+        for (uint16_t x = 0; x < mapWidth; x++)
+        {
+            // Fully lit below the level, partly lit in the top row, off above
+            CRGB pixel = rowColor;
+            pixel.nscale8(min(max(columnLevel[x] - rowBase, (int32_t)0), (int32_t)255));
+            out[*cell++] = pixel;
+        }
+    }
+}
+
+void renderStripState(const StripState &state, CRGB *out)
+{
+    switch (state.mode)
     {
     case MODE_OFF:
-        FastLED.clear();
-        FastLED.show();
+        fill_solid(out, NUM_LEDS, CRGB::Black);
         break;
     case MODE_SOLID:
-        setStripColor(currentColor);
+        fill_solid(out, NUM_LEDS, state.color);
         break;
     case MODE_RAINBOW:
-        rainbowEffect();
+        rainbowEffect(out);
         break;
     case MODE_VISUALIZER:
-        musicVisualizerEffect();
+        musicVisualizerEffect(out);
+        break;
+    case MODE_PIXELS:
+        memcpy(out, pixelFrame, sizeof(pixelFrame));
+        break;
+    case MODE_RAINBOW_2D:
+        rainbow2DEffect(out);
+        break;
+    case MODE_SPECTRUM:
+        spectrumEffect(out);
+        break;
+    case MODE_VM:
+        vmRenderEffect(out, (uint64_t)frameMillis * effectSpeed / EFFECT_SPEED_DEFAULT, latestMusic, beatPhase);
+        break;
+    default:
         break;
     }
 }
 
-void handleMusicVisualization(String musicData)
+// With a locked tempo the flash fires on the predicted beat, tempoLeadMs
+// ahead, instead of a whole input path behind the onset that caused it
+static void updateBeatPrediction()
 {
-    // Parse music data and create visualization
-    // Format: "freq1,freq2,freq3,beat" or JSON-like data
-    // For now, create a simple beat-responsive effect
+    uint16_t previous = beatPhase;
+    beatPhase = tempoPredictedPhase(frameMillis * 1000UL);
+    if (tempoLocked() && previous > 0xC000 && beatPhase < 0x4000)
+    {
+        musicBeatTime = frameMillis;
+        musicBeatFresh = true;
+        musicFlashLevel = tempoStats.lastLevel;
+    }
+}
 
-    if (currentMode == MODE_VISUALIZER)
+static void updateEffectPhases()
+{
+    // At EFFECT_SPEED_DEFAULT this matches the original 3 and 2 steps per frame
+    uint64_t scaled = (uint64_t)frameMillis * effectSpeed;
+    rainbowHue = scaled * 12 / FRAME_INTERVAL_MS;
+    visualizerBeat = scaled * 8 / FRAME_INTERVAL_MS;
+}
+
+static uint8_t applyEasing(uint8_t progress)
+{
+    switch (transitionEasing)
     {
-        // Simple example: flash intensity based on beat
-        int beatValue = musicData.toInt(); // Simple parsing for demo
-        int intensity = map(constrain(beatValue, 0, 100), 0, 100, 50, 255);
+    case EASE_QUAD:
+        return ease8InOutQuad(progress);
+    case EASE_CUBIC:
+        return ease8InOutCubic(progress);
+    default:
+        return progress;
+    }
+}
 
-        // Create beat-responsive effect
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            leds[i] = CHSV(160 + (beatValue % 60), 255, intensity);
-        }
-        FastLED.show();
+static void startTransition(const StripState &from)
+{
+    if (transition.active)
+    {
+        // Retargeted mid-fade: fade out from exactly what is on the strip now
+        memcpy(transitionFrom, leds, sizeof(transitionFrom));
+        transition.frozen = true;
+        transition.sameEffect = false;
+        transition.from.brightness = frameBrightness;
     }
+    else
+    {
+        transition.frozen = false;
+        transition.sameEffect = from.mode == currentMode &&
+                                (from.mode != MODE_SOLID || from.color == currentColor);
+        transition.from = from;
+    }
+    transition.active = true;
+    transition.startMs = frameMillis;
+    transition.durationMs = transitionDurationMs;
+}
+
+// Blends the outgoing effect under the freshly rendered incoming frame in leds[]
+static void renderTransition(unsigned long now)
+{
+    unsigned long elapsed = now - transition.startMs;
+    if (elapsed >= transition.durationMs)
+    {
+        transition.active = false;
+        frameBrightness = currentBrightness;
+        return;
+    }
+
+    uint8_t amount = applyEasing((elapsed * 255) / transition.durationMs);
+
+    if (!transition.sameEffect)
+    {
+        if (!transition.frozen)
+            renderStripState(transition.from, transitionFrom);
+        blendSpan(transitionFrom, leds, leds, NUM_LEDS, amount);
+    }
+    frameBrightness = lerp8by8(transition.from.brightness, currentBrightness, amount);
+}
+
+void handleLedStrip()
+{
+    uint32_t now = syncedMillis();
+    uint32_t frameIndex = now / FRAME_INTERVAL_MS;
+    if (frameIndex == lastFrameIndex)
+        return;
+    lastFrameIndex = frameIndex;
+    frameMillis = clockSimulated ? simulatedFrame++ * FRAME_INTERVAL_MS : now;
+
+    // Timeline cues and scheduled commands due on this frame stage their
+    // changes before they apply
+    timelineTick(frameMillis);
+    runScheduledCommands();
+
+    // Only the newest music input since the last frame is rendered
+    MusicFrame input;
+    bool haveInput = takeMusicFrame(input);
+    if (haveInput)
+        handleMusicVisualization(input);
+    updateBeatPrediction();
+
+    // Frame boundary - everything staged since the last frame lands together
+    applyPendingState();
+
+    // A static frame that is already on the strip is not pushed again
+    if (staticFrameShown && ledStripIdle())
+        return;
+
+    uint32_t renderStart = micros();
+    StripState state = {currentMode, currentColor, currentBrightness, effectSpeed};
+    updateEffectPhases();
+    renderStripState(state, leds);
+
+    if (transition.active)
+    {
+        uint32_t transitionStart = micros();
+        renderTransition(frameMillis);
+        frameMetrics.transitionUs = micros() - transitionStart;
+        frameMetrics.transitionMaxUs = max(frameMetrics.transitionMaxUs, frameMetrics.transitionUs);
+    }
+    else
+    {
+        frameMetrics.transitionUs = 0;
+    }
+
+    captureFrame(leds, frameBrightness, frameMillis);
+
+    uint32_t showStart = micros();
+    ledDriver->submit(leds, frameBrightness);
+    staticFrameShown = ledStripIdle();
+
+    frameMetrics.frames++;
+    frameMetrics.renderUs = showStart - renderStart;
+    frameMetrics.renderMaxUs = max(frameMetrics.renderMaxUs, frameMetrics.renderUs);
+    frameMetrics.showUs = micros() - showStart;
+
+    if (haveInput)
+        recordInputLatency(micros() - input.receivedUs);
+}
+
+// Times the built-in effects into a scratch buffer. The visualizer's beat
+// flash state is saved and restored, so a benchmark never eats a live beat.
+void benchmarkBuiltinEffects(CRGB *scratch, uint16_t frames, uint32_t &rainbowNs, uint32_t &visualizerNs)
+{
+    bool savedFresh = musicBeatFresh;
+    unsigned long savedTime = musicBeatTime;
+    uint8_t savedLevel = musicFlashLevel;
+
+    uint32_t start = micros();
+    for (uint16_t frame = 0; frame < frames; frame++)
+        rainbowEffect(scratch);
+    rainbowNs = (uint64_t)(micros() - start) * 1000 / (frames * NUM_LEDS);
+
+    start = micros();
+    for (uint16_t frame = 0; frame < frames; frame++)
+        musicVisualizerEffect(scratch);
+    visualizerNs = (uint64_t)(micros() - start) * 1000 / (frames * NUM_LEDS);
+
+    musicBeatFresh = savedFresh;
+    musicBeatTime = savedTime;
+    musicFlashLevel = savedLevel;
+}
+
+// True while the strip shows a frame that cannot change on its own
+bool ledStripIdle()
+{
+    return (currentMode == MODE_OFF || currentMode == MODE_SOLID) &&
+           !transition.active && !statePending && !timelinePlaying && !captureActive;
+}
+
+// Firmware transfers block loop() until they finish, so their progress
+// callbacks call this to keep the strip animating at a reduced frame rate
+// and the log and responses draining
+void handleLedStripDuringUpdate()
+{
+    static unsigned long lastUpdateFrameMs = 0;
+    if (millis() - lastUpdateFrameMs < UPDATE_RENDER_INTERVAL_MS)
+        return;
+    lastUpdateFrameMs = millis();
+    handleLedStrip();
+    logFlush();
+}
+
+void handleMusicVisualization(const MusicFrame &music)
+{
+    // Simple beat-responsive effect, drawn by the visualizer from this frame
+    // on. Once the tempo tracker locks, predicted beats take over the flash.
+    latestMusic = music;
+    if (tempoLocked())
+        return;
+    musicBeatTime = frameMillis;
+    musicBeatFresh = true;
+    musicFlashLevel = music.beat;
+}
+
+void stageMode(LedMode mode)
+{
+    pendingState.mode = mode;
+    statePending = true;
+}
+
+void stageColor(CRGB color)
+{
+    pendingState.color = color;
+    statePending = true;
+}
+
+void stageBrightness(uint8_t brightness)
+{
+    pendingState.brightness = brightness;
+    statePending = true;
+}
+
+void stageSpeed(uint8_t speed)
+{
+    pendingState.speed = speed;
+    statePending = true;
+}
+
+void stageState(const StripState &state)
+{
+    pendingState = state;
+    statePending = true;
+}
+
+void applyPendingState()
+{
+    if (!statePending)
+        return;
+
+    StripState previous = {currentMode, currentColor, currentBrightness, effectSpeed};
+    bool changed = previous.mode != pendingState.mode ||
+                   previous.color != pendingState.color ||
+                   previous.brightness != pendingState.brightness;
+
+    currentMode = pendingState.mode;
+    currentColor = pendingState.color;
+    currentBrightness = pendingState.brightness;
+    effectSpeed = pendingState.speed;
+    statePending = false;
+    staticFrameShown = false;
+
+    if (changed && transitionDurationMs > 0)
+    {
+        startTransition(previous);
+    }
+    else if (changed || !transition.active)
+    {
+        transition.active = false;
+        frameBrightness = currentBrightness;
+    }
+}
+
+bool parseLedMode(const String &name, LedMode &mode)
+{
+    if (name == "off")
+        mode = MODE_OFF;
+    else if (name == "solid")
+        mode = MODE_SOLID;
+    else if (name == "rainbow")
+        mode = MODE_RAINBOW;
+    else if (name == "visualizer")
+        mode = MODE_VISUALIZER;
+    else if (name == "pixels")
+        mode = MODE_PIXELS;
+    else if (name == "rainbow2d")
+        mode = MODE_RAINBOW_2D;
+    else if (name == "spectrum")
+        mode = MODE_SPECTRUM;
+    else if (name == "vm")
+        mode = MODE_VM;
+    else
+        return false;
+    return true;
+}
+
+bool parseColor(const String &name, CRGB &color)
+{
+    if (name == "red")
+        color = CRGB::Red;
+    else if (name == "green")
+        color = CRGB::Green;
+    else if (name == "blue")
+        color = CRGB::Blue;
+    else if (name == "yellow")
+        color = CRGB::Yellow;
+    else if (name == "white")
+        color = CRGB::White;
+    else if (name.length() == 7 && name[0] == '#')
+    {
+        // Hex color "#rrggbb"
+        char *end;
+        uint32_t value = strtoul(name.c_str() + 1, &end, 16);
+        if (*end != '\0')
+            return false;
+        color = CRGB(value);
+    }
+    else
+        return false;
+    return true;
+}
+
+const char *ledModeName(LedMode mode)
+{
+    switch (mode)
+    {
+    case MODE_OFF:
+        return "off";
+    case MODE_SOLID:
+        return "solid";
+    case MODE_RAINBOW:
+        return "rainbow";
+    case MODE_VISUALIZER:
+        return "visualizer";
+    case MODE_RAINBOW_2D:
+        return "rainbow2d";
+    case MODE_SPECTRUM:
+        return "spectrum";
+    case MODE_VM:
+        return "vm";
+    default:
+        return "pixels";
+    }
+}
+
+bool parseEasing(const String &name, EasingCurve &curve)
+{
+    if (name == "linear")
+        curve = EASE_LINEAR;
+    else if (name == "quad")
+        curve = EASE_QUAD;
+    else if (name == "cubic")
+        curve = EASE_CUBIC;
+    else
+        return false;
+    return true;
+}
+
+const char *easingName(EasingCurve curve)
+{
+    switch (curve)
+    {
+    case EASE_LINEAR:
+        return "linear";
+    case EASE_QUAD:
+        return "quad";
+    default:
+        return "cubic";
+    }
+}
+
+void setSimulatedClock(bool enabled)
+{
+    clockSimulated = enabled;
+    simulatedFrame = 0;
+
+    // A fade or beat flash timed on the other clock would end at random
+    transition.active = false;
+    musicBeatFresh = false;
+    staticFrameShown = false;
+    frameBrightness = currentBrightness;
+    resetTempo(); // The beat grid too
+}
+
+uint32_t frameClockMillis()
+{
+    // Time the next frame will see, for anything that anchors to frame time
+    return clockSimulated ? simulatedFrame * FRAME_INTERVAL_MS : syncedMillis();
+}
+
+uint32_t frameClockMicros()
+{
+    // Same clock in microseconds, wrapping like micros()
+    return clockSimulated ? simulatedFrame * FRAME_INTERVAL_MS * 1000UL : (uint32_t)syncedMicros();
+}
+
+void resetFrameMetrics()
+{
+    frameMetrics = {};
 }
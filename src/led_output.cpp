@@ -0,0 +1,152 @@
+#include "led_output.h"
+#include "config.h"
+#include "logger.h"
+#include <freertos/semphr.h>
+
+// LED Output State Variables
+const LedDriver *ledDriver = &syncLedDriver;
+LedOutputStats ledOutputStats = {};
+
+// Front buffer, registered with FastLED. The renderer draws the next frame
+// into leds[] while this one is on the wire.
+static CRGB outputFrame[NUM_LEDS];
+static uint8_t outputBrightness = BRIGHTNESS;
+static CLEDController *outputController = nullptr;
+
+static void recordTransmit(uint32_t elapsedUs)
+{
+    ledOutputStats.transmitUs = elapsedUs;
+    ledOutputStats.transmitMaxUs = max(ledOutputStats.transmitMaxUs, elapsedUs);
+}
+
+static void transmit()
+{
+    // Brightness comes with the frame and goes straight to the controller -
+    // FastLED's global brightness is never read or written here
+    uint32_t start = micros();
+    outputController->showLeds(outputBrightness);
+    recordTransmit(micros() - start);
+}
+
+// ---- Synchronous driver: transmits before submit() returns ---------------
+
+static bool syncBegin()
+{
+    return true;
+}
+
+static void syncSubmit(const CRGB *frame, uint8_t brightness)
+{
+    memcpy(outputFrame, frame, sizeof(outputFrame));
+    outputBrightness = brightness;
+    ledOutputStats.frames++;
+    transmit();
+}
+
+static void syncWaitIdle()
+{
+}
+
+const LedDriver syncLedDriver = {"sync", syncBegin, syncSubmit, syncWaitIdle};
+
+// ---- Asynchronous driver: a task on LED_OUTPUT_CORE transmits ------------
+// FastLED's RMT driver blocks the calling task for the whole bit stream,
+// about 30 us per LED. Here that task is the output task, and loop() goes
+// on to the next frame. outputIdle is the fence: it is free whenever
+// outputFrame may be overwritten.
+
+static TaskHandle_t outputTask = nullptr;
+static SemaphoreHandle_t outputIdle = nullptr;
+static bool stackWarned = false;
+
+static void outputTaskLoop(void *)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        transmit();
+        ledOutputStats.stackFreeMin = uxTaskGetStackHighWaterMark(nullptr);
+        xSemaphoreGive(outputIdle);
+    }
+}
+
+static bool asyncBegin()
+{
+    if (outputTask)
+        return true;
+
+    outputIdle = xSemaphoreCreateBinary();
+    if (!outputIdle)
+        return false;
+    xSemaphoreGive(outputIdle);
+
+    return xTaskCreatePinnedToCore(outputTaskLoop, "ledOutput", LED_OUTPUT_STACK, nullptr,
+                                   LED_OUTPUT_PRIORITY, &outputTask, LED_OUTPUT_CORE) == pdPASS;
+}
+
+static void asyncWaitIdle()
+{
+    uint32_t start = micros();
+    xSemaphoreTake(outputIdle, portMAX_DELAY);
+    uint32_t waited = micros() - start;
+    ledOutputStats.fenceWaitUs = waited;
+    ledOutputStats.fenceWaitMaxUs = max(ledOutputStats.fenceWaitMaxUs, waited);
+    xSemaphoreGive(outputIdle);
+}
+
+static void asyncSubmit(const CRGB *frame, uint8_t brightness)
+{
+    // Fence first - the previous frame may still be going out of outputFrame
+    uint32_t start = micros();
+    xSemaphoreTake(outputIdle, portMAX_DELAY);
+    uint32_t waited = micros() - start;
+    ledOutputStats.fenceWaitUs = waited;
+    ledOutputStats.fenceWaitMaxUs = max(ledOutputStats.fenceWaitMaxUs, waited);
+
+    // The output task measures its stack; the warning is logged from here
+    // because only loop() writes the log
+    if (!stackWarned && ledOutputStats.stackFreeMin > 0 && ledOutputStats.stackFreeMin < LED_OUTPUT_STACK_MARGIN)
+    {
+        LOG_W("OUT", "Output task stack low: %u of %u bytes free", (unsigned)ledOutputStats.stackFreeMin,
+              LED_OUTPUT_STACK);
+        stackWarned = true;
+    }
+
+    memcpy(outputFrame, frame, sizeof(outputFrame));
+    outputBrightness = brightness;
+    ledOutputStats.frames++;
+    xTaskNotifyGive(outputTask);
+}
+
+const LedDriver asyncLedDriver = {"async", asyncBegin, asyncSubmit, asyncWaitIdle};
+
+// ---- Driver selection ------------------------------------------------------
+
+void initializeLedOutput()
+{
+    outputController = &FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(outputFrame, NUM_LEDS);
+    setLedDriver(LED_OUTPUT_ASYNC ? &asyncLedDriver : &syncLedDriver);
+}
+
+// Falls back to the synchronous driver if the requested one cannot start
+bool setLedDriver(const LedDriver *driver)
+{
+    ledDriver->waitIdle();
+    if (!driver->begin())
+    {
+        LOG_W("OUT", "%s LED output unavailable, using sync", driver->name);
+        ledDriver = &syncLedDriver;
+        return false;
+    }
+    ledDriver = driver;
+    LOG_I("OUT", "LED output: %s", driver->name);
+    return true;
+}
+
+void resetLedOutputStats()
+{
+    // The stack high-water mark only ever falls, so it survives a reset
+    uint32_t stackFreeMin = ledOutputStats.stackFreeMin;
+    ledOutputStats = {};
+    ledOutputStats.stackFreeMin = stackFreeMin;
+}
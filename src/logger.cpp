@@ -0,0 +1,218 @@
+#include "logger.h"
+#include <atomic>
+
+// Logging State Variables
+uint8_t logLevel = LOG_RUNTIME_LEVEL;
+bool quietMode = false;
+uint32_t logDropped = 0;
+
+// Single-producer/single-consumer byte ring. Indices run freely and are
+// masked on access, so the size must be a power of two.
+struct ByteRing
+{
+    char *data;
+    size_t size;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two");
+static_assert((RESPONSE_BUFFER_SIZE & (RESPONSE_BUFFER_SIZE - 1)) == 0, "RESPONSE_BUFFER_SIZE must be a power of two");
+
+static char logStorage[LOG_BUFFER_SIZE];
+static char responseStorage[RESPONSE_BUFFER_SIZE];
+static ByteRing logRing = {logStorage, LOG_BUFFER_SIZE, {0}, {0}};
+static ByteRing responseRing = {responseStorage, RESPONSE_BUFFER_SIZE, {0}, {0}};
+
+// True while a log line has only partially reached the UART; responses must
+// wait for the line to finish so the two channels never interleave mid-line.
+static bool logMidLine = false;
+
+static bool ringPush(ByteRing &ring, const char *bytes, size_t length)
+{
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    size_t tail = ring.tail.load(std::memory_order_acquire);
+    if (length > ring.size - (head - tail))
+        return false;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        ring.data[(head + i) & (ring.size - 1)] = bytes[i];
+    }
+    ring.head.store(head + length, std::memory_order_release);
+    return true;
+}
+
+// Writes at most maxBytes from the ring to the UART. Returns bytes written.
+static size_t ringDrain(ByteRing &ring, size_t maxBytes, bool stopAtNewline)
+{
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    size_t head = ring.head.load(std::memory_order_acquire);
+    size_t pending = head - tail;
+    size_t written = 0;
+
+    while (written < maxBytes && written < pending)
+    {
+        size_t offset = (tail + written) & (ring.size - 1);
+        size_t chunk = min(min(maxBytes - written, pending - written), ring.size - offset);
+        if (stopAtNewline)
+        {
+            const char *newline = (const char *)memchr(ring.data + offset, '\n', chunk);
+            if (newline)
+                chunk = (newline - (ring.data + offset)) + 1;
+        }
+        Serial.write((const uint8_t *)ring.data + offset, chunk);
+        written += chunk;
+        if (stopAtNewline && ring.data[(offset + chunk - 1) & (ring.size - 1)] == '\n')
+            break;
+    }
+
+    ring.tail.store(tail + written, std::memory_order_release);
+    return written;
+}
+
+static bool ringEmpty(ByteRing &ring)
+{
+    return ring.head.load(std::memory_order_acquire) == ring.tail.load(std::memory_order_relaxed);
+}
+
+static char levelLetter(uint8_t level)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_ERROR:
+        return 'E';
+    case LOG_LEVEL_WARN:
+        return 'W';
+    case LOG_LEVEL_INFO:
+        return 'I';
+    default:
+        return 'D';
+    }
+}
+
+void logWrite(uint8_t level, const char *tag, const char *format, ...)
+{
+    if (level > logLevel)
+        return;
+
+    char line[LOG_LINE_MAX];
+    int prefix = snprintf(line, sizeof(line), "[%c][%s] ", levelLetter(level), tag);
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line + prefix, sizeof(line) - prefix - 1, format, args);
+    va_end(args);
+
+    length = min(prefix + max(length, 0), (int)sizeof(line) - 2);
+    line[length++] = '\n';
+
+    if (!ringPush(logRing, line, length))
+        logDropped++;
+}
+
+void sendResponse(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    sendResponseV(format, args);
+    va_end(args);
+}
+
+void sendResponseV(const char *format, va_list args)
+{
+    char line[LOG_LINE_MAX];
+    memcpy(line, "RESPONSE:", 9);
+
+    int length = vsnprintf(line + 9, sizeof(line) - 9 - 1, format, args);
+
+    length = min(9 + max(length, 0), (int)sizeof(line) - 2);
+    line[length++] = '\n';
+
+    // Protocol responses are never dropped - if the channel is full, drain
+    // synchronously until the line fits.
+    while (!ringPush(responseRing, line, length))
+    {
+        logFlushAll();
+    }
+}
+
+void logFlush()
+{
+    size_t budget = Serial.availableForWrite();
+
+    if (logMidLine && budget > 0)
+    {
+        size_t written = ringDrain(logRing, budget, true);
+        budget -= written;
+        size_t tail = logRing.tail.load(std::memory_order_relaxed);
+        logMidLine = written > 0 && logRing.data[(tail - 1) & (logRing.size - 1)] != '\n';
+        if (logMidLine)
+            return;
+    }
+
+    budget -= ringDrain(responseRing, budget, false);
+
+    if (budget > 0 && !ringEmpty(logRing))
+    {
+        size_t written = ringDrain(logRing, budget, false);
+        size_t tail = logRing.tail.load(std::memory_order_relaxed);
+        logMidLine = written > 0 && logRing.data[(tail - 1) & (logRing.size - 1)] != '\n';
+    }
+}
+
+// Anything still waiting for the UART, responses or log lines
+bool logOutputPending()
+{
+    return logMidLine || !ringEmpty(responseRing) || !ringEmpty(logRing);
+}
+
+void logFlushAll()
+{
+    // Used where blocking is acceptable (setup, restart, full response channel)
+    while (!ringEmpty(responseRing) || !ringEmpty(logRing))
+    {
+        if (logMidLine)
+        {
+            ringDrain(logRing, LOG_BUFFER_SIZE, true);
+            logMidLine = false;
+        }
+        ringDrain(responseRing, RESPONSE_BUFFER_SIZE, false);
+        ringDrain(logRing, LOG_BUFFER_SIZE, false);
+    }
+    Serial.flush();
+}
+
+bool parseLogLevel(const String &name, uint8_t &level)
+{
+    if (name == "none")
+        level = LOG_LEVEL_NONE;
+    else if (name == "error")
+        level = LOG_LEVEL_ERROR;
+    else if (name == "warn")
+        level = LOG_LEVEL_WARN;
+    else if (name == "info")
+        level = LOG_LEVEL_INFO;
+    else if (name == "debug")
+        level = LOG_LEVEL_DEBUG;
+    else
+        return false;
+    return true;
+}
+
+const char *logLevelName(uint8_t level)
+{
+    switch (level)
+    {
+    case LOG_LEVEL_NONE:
+        return "none";
+    case LOG_LEVEL_ERROR:
+        return "error";
+    case LOG_LEVEL_WARN:
+        return "warn";
+    case LOG_LEVEL_INFO:
+        return "info";
+    default:
+        return "debug";
+    }
+}
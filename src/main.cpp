@@ -10,6 +10,12 @@
 #include "ota_update.h"
 #include "auto_update.h"
 #include "web_server.h"
+#include "logger.h"
+#include "timeline.h"
+#include "pixel_map.h"
+#include "effect_vm.h"
+#include "time_sync.h"
+#include "power_manager.h"
 #include "wifi_credentials.h"
 
 void setup()
@@ -19,11 +25,17 @@ void setup()
 
   // Initialize LED strip and built-in LED
   initializeLEDs();
-  Serial.println("LED strip initialized (60 LEDs)");
+  LOG_I("MAIN", "LED strip initialized (%d LEDs)", NUM_LEDS);
+
+  // Mount LittleFS and load any stored show timeline
+  initializeTimeline();
+  initializePixelMap();
+  initializeEffectVm();
 
   // WiFi Connection
-  Serial.println("\n=== Attempting WiFi Connection ===");
-  Serial.println("Note: WiFi is optional - USB serial control always available");
+  LOG_I("MAIN", "=== Attempting WiFi Connection ===");
+  LOG_I("MAIN", "Note: WiFi is optional - USB serial control always available");
+  logFlushAll();
 
   WiFi.mode(WIFI_STA);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -32,13 +44,13 @@ void setup()
   while (WiFi.status() != WL_CONNECTED && attempts < 30)
   {
     delay(1000);
-    Serial.print(".");
+    LOG_D("MAIN", "Waiting for WiFi (%d)", attempts);
+    logFlush();
     attempts++;
 
     if (attempts % 10 == 0)
     {
-      Serial.println();
-      Serial.println("Retrying WiFi connection...");
+      LOG_I("MAIN", "Retrying WiFi connection...");
       WiFi.disconnect();
       delay(1000);
       WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -47,54 +59,52 @@ void setup()
 
   if (WiFi.status() == WL_CONNECTED)
   {
-    Serial.println("");
-    Serial.println("=== WiFi connected successfully! ===");
-    Serial.print("IPv4 address: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("Signal strength (RSSI): ");
-    Serial.print(WiFi.RSSI());
-    Serial.println(" dBm");
+    LOG_I("MAIN", "=== WiFi connected successfully! ===");
+    LOG_I("MAIN", "IPv4 address: %s", WiFi.localIP().toString().c_str());
+    LOG_I("MAIN", "Signal strength (RSSI): %d dBm", WiFi.RSSI());
 
     // Initialize mDNS
     if (MDNS.begin(DEVICE_NAME.c_str()))
     {
-      Serial.println("mDNS responder started: " + DEVICE_NAME + ".local");
+      LOG_I("MAIN", "mDNS responder started: %s.local", DEVICE_NAME.c_str());
       MDNS.addService("http", "tcp", 80);
     }
 
-    // Setup OTA and Auto-updates
+    // Setup OTA
     setupOTA();
 
-    Serial.println("=================================");
-    Serial.println("🌐 Open your browser and go to:");
-    Serial.print("   http://");
-    Serial.println(WiFi.localIP());
-    Serial.println("=================================");
+    LOG_I("MAIN", "🌐 Open your browser and go to: http://%s", WiFi.localIP().toString().c_str());
   }
   else
   {
-    Serial.println("");
-    Serial.println("=== WiFi connection failed! ===");
-    Serial.println("Continuing with USB serial control only...");
+    LOG_W("MAIN", "=== WiFi connection failed! ===");
+    LOG_W("MAIN", "Continuing with USB serial control only...");
   }
 
+  // Load the manifest URL and rollout cohort even without WiFi, so
+  // update:status is right and checks work once WiFi connects later
+  // (WiFi.mode() has already set the MAC the cohort is taken from)
+  initializeAutoUpdate();
+
   // Initialize web server
   initializeWebServer();
 
   // Print available commands
-  Serial.println("\n=== USB Serial Control Ready ===");
-  Serial.println("Available commands:");
-  Serial.println("- ping (test connection)");
-  Serial.println("- off, solid, rainbow, visualizer");
-  Serial.println("- red, green, blue, yellow, white");
-  Serial.println("- ledon, ledoff, toggle, status, info");
-  Serial.println("- brightness:0-255");
-  Serial.println("- music:data (for real-time music sync)");
-  Serial.println("- update:check, update:enable, update:disable, update:now");
-  Serial.println("=================================");
-
-  Serial.println("RESPONSE:READY");
+  LOG_I("MAIN", "=== USB Serial Control Ready ===");
+  LOG_I("MAIN", "Available commands:");
+  LOG_I("MAIN", "- ping (test connection)");
+  LOG_I("MAIN", "- off, solid, rainbow, visualizer");
+  LOG_I("MAIN", "- red, green, blue, yellow, white");
+  LOG_I("MAIN", "- ledon, ledoff, toggle, status, info");
+  LOG_I("MAIN", "- brightness:0-255");
+  LOG_I("MAIN", "- music:data (for real-time music sync)");
+  LOG_I("MAIN", "- update:check, update:enable, update:disable, update:now");
+  LOG_I("MAIN", "- log:none/error/warn/info/debug, log:stats, quiet:on/off");
+
+  sendResponse("READY");
+  logFlushAll();
   lastSerialActivity = millis();
+  initializePowerManager();
 }
 
 void loop()
@@ -111,26 +121,30 @@ void loop()
     handleAutoUpdate();
   }
 
+  // Exchange clock sync packets with the master, if any
+  handleTimeSync();
+
   // Check for USB serial commands
   checkSerialInput();
 
   // Handle web server requests
   server.handleClient();
 
-  // Update LED strip (skip during updates)
-  if (!otaInProgress && !updateInProgress)
-  {
-    handleLedStrip();
-  }
+  // Update LED strip - update transfers also tick it from their callbacks
+  handleLedStrip();
 
   // Send periodic heartbeat if USB connected
   static unsigned long lastHeartbeat = 0;
   if (serialConnected && (millis() - lastHeartbeat) > 10000)
   {
-    Serial.println("RESPONSE:HEARTBEAT");
+    sendResponse("HEARTBEAT");
     lastHeartbeat = millis();
   }
 
-  // Small delay to prevent watchdog issues
-  delay(10);
+  // Drain buffered log output and responses without blocking
+  logFlush();
+
+  // Yield a tick while animating, or wait for input at a lower rate when
+  // the strip is static - frame pacing happens in handleLedStrip()
+  powerLoopWait();
 }
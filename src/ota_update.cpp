@@ -1,11 +1,12 @@
 #include "ota_update.h"
 #include "config.h"
 #include <ArduinoOTA.h>
-#include <FastLED.h>
+#include "led_control.h"
+#include "logger.h"
 
 // OTA State Variables
 bool otaInProgress = false;
-String otaStatus = "Ready";
+char otaStatus[48] = "Ready";
 
 void setupOTA()
 {
@@ -14,36 +15,37 @@ void setupOTA()
 
     ArduinoOTA.onStart([]()
                        {
-    String type;
-    if (ArduinoOTA.getCommand() == U_FLASH) {
-      type = "sketch";
-    } else { // U_SPIFFS
-      type = "filesystem";
-    }
-    
+    const char *type = ArduinoOTA.getCommand() == U_FLASH ? "sketch" : "filesystem";
+
     otaInProgress = true;
-    otaStatus = "Starting " + type + " update...";
-    Serial.println("OTA Update Starting: " + type);
-    
-    // Turn off LED strip during update to save power and avoid conflicts
-    FastLED.clear();
-    FastLED.show();
-    
+    snprintf(otaStatus, sizeof(otaStatus), "Starting %s update...", type);
+    LOG_I("OTA", "OTA Update Starting: %s", type);
+
     // Turn on built-in LED to indicate OTA in progress
     digitalWrite(BUILTIN_LED_PIN, HIGH); });
 
     ArduinoOTA.onEnd([]()
                      {
     otaInProgress = false;
-    otaStatus = "Update complete! Restarting...";
-    Serial.println("\nOTA Update Complete");
+    snprintf(otaStatus, sizeof(otaStatus), "Update complete! Restarting...");
+    LOG_I("OTA", "OTA Update Complete");
+    logFlushAll();
     digitalWrite(BUILTIN_LED_PIN, LOW); });
 
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total)
                           {
-    int percent = (progress / (total / 100));
-    otaStatus = "Progress: " + String(percent) + "%";
-    Serial.printf("OTA Progress: %u%%\r", percent);
+    // Called for every received chunk - keep it cheap and allocation free
+    handleLedStripDuringUpdate();
+
+    static int lastPercent = -1;
+    int percent = (uint64_t)progress * 100 / total;
+    if (percent == lastPercent)
+      return;
+    lastPercent = percent;
+
+    snprintf(otaStatus, sizeof(otaStatus), "Progress: %d%%", percent);
+    if (percent % 10 == 0)
+      LOG_I("OTA", "OTA Progress: %d%%", percent);
     
     // Blink built-in LED to show progress
     digitalWrite(BUILTIN_LED_PIN, (percent % 10 < 5) ? HIGH : LOW); });
@@ -51,29 +53,25 @@ void setupOTA()
     ArduinoOTA.onError([](ota_error_t error)
                        {
     otaInProgress = false;
-    otaStatus = "Update failed: ";
-    Serial.printf("OTA Error[%u]: ", error);
-    
+    const char *reason = "Unknown";
+
     if (error == OTA_AUTH_ERROR) {
-      otaStatus += "Auth Failed";
-      Serial.println("Auth Failed");
+      reason = "Auth Failed";
     } else if (error == OTA_BEGIN_ERROR) {
-      otaStatus += "Begin Failed";
-      Serial.println("Begin Failed");
+      reason = "Begin Failed";
     } else if (error == OTA_CONNECT_ERROR) {
-      otaStatus += "Connect Failed";
-      Serial.println("Connect Failed");
+      reason = "Connect Failed";
     } else if (error == OTA_RECEIVE_ERROR) {
-      otaStatus += "Receive Failed";
-      Serial.println("Receive Failed");
+      reason = "Receive Failed";
     } else if (error == OTA_END_ERROR) {
-      otaStatus += "End Failed";
-      Serial.println("End Failed");
+      reason = "End Failed";
     }
+    snprintf(otaStatus, sizeof(otaStatus), "Update failed: %s", reason);
+    LOG_E("OTA", "OTA Error[%u]: %s", (unsigned)error, otaStatus);
     
     digitalWrite(BUILTIN_LED_PIN, LOW); });
 
     ArduinoOTA.begin();
-    Serial.println("OTA update service started");
-    Serial.println("Device hostname: " + String(DEVICE_NAME));
+    LOG_I("OTA", "OTA update service started");
+    LOG_I("OTA", "Device hostname: %s", DEVICE_NAME.c_str());
 }
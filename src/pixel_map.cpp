@@ -0,0 +1,165 @@
+#include "pixel_map.h"
+#include "logger.h"
+#include <LittleFS.h>
+
+// The built-in layout is resolved entirely by the compiler and lives in flash
+static constexpr MatrixLayout BUILTIN_LAYOUT = {MATRIX_WIDTH, MATRIX_HEIGHT, MATRIX_SERPENTINE, MATRIX_ROTATION};
+static constexpr size_t BUILTIN_CELLS = MATRIX_WIDTH * MATRIX_HEIGHT;
+static constexpr XYTable<BUILTIN_CELLS> builtinTable = buildMatrixTable<BUILTIN_CELLS>(BUILTIN_LAYOUT);
+
+static_assert(BUILTIN_CELLS <= PIXEL_MAP_MAX_CELLS, "Matrix larger than PIXEL_MAP_MAX_CELLS");
+static_assert(MATRIX_ROTATION != 0 || builtinTable.index[0] == 0, "Unrotated matrix must start at LED 0");
+
+// Pixel Map State Variables
+const uint16_t *xyTable = builtinTable.index;
+uint16_t mapWidth = logicalWidth(BUILTIN_LAYOUT);
+uint16_t mapHeight = logicalHeight(BUILTIN_LAYOUT);
+bool mapCoversAllLeds = BUILTIN_CELLS >= NUM_LEDS;
+const char *mapSource = "builtin";
+
+// Runtime maps are built once, when they are loaded, into whichever of
+// these two tables is not active. A map that fails part way through never
+// touches the table the effects are reading.
+static uint16_t runtimeTables[2][PIXEL_MAP_MAX_CELLS];
+static File uploadFile;
+
+static uint16_t *spareRuntimeTable()
+{
+    return xyTable == runtimeTables[0] ? runtimeTables[1] : runtimeTables[0];
+}
+
+// File layout: "LPM1", u8 grid width, u8 grid height, u16 LED count, then
+// u8 x, u8 y per LED in wiring order (x or y out of range = not on the grid)
+static const uint8_t PIXEL_MAP_MAGIC[4] = {'L', 'P', 'M', '1'};
+static const size_t PIXEL_MAP_HEADER_SIZE = 8;
+
+static bool coversAllLeds(const uint16_t *table, size_t cells)
+{
+    uint8_t seen[(NUM_LEDS + 7) / 8] = {};
+    uint16_t count = 0;
+    for (size_t i = 0; i < cells; i++)
+    {
+        uint16_t led = table[i];
+        if (led < NUM_LEDS && !(seen[led >> 3] & (1 << (led & 7))))
+        {
+            seen[led >> 3] |= 1 << (led & 7);
+            count++;
+        }
+    }
+    return count == NUM_LEDS;
+}
+
+static void activate(const uint16_t *table, uint16_t width, uint16_t height, const char *source)
+{
+    xyTable = table;
+    mapWidth = width;
+    mapHeight = height;
+    mapCoversAllLeds = coversAllLeds(table, (size_t)width * height);
+    mapSource = source;
+    LOG_I("MAP", "Pixel map %s: %ux%u%s", source, width, height, mapCoversAllLeds ? "" : " (partial)");
+}
+
+// Also forgets any uploaded map, so the built-in layout is used after a restart
+void useBuiltinPixelMap()
+{
+    LittleFS.remove(PIXEL_MAP_PATH);
+    activate(builtinTable.index, logicalWidth(BUILTIN_LAYOUT), logicalHeight(BUILTIN_LAYOUT), "builtin");
+}
+
+bool buildMatrixPixelMap(const MatrixLayout &layout)
+{
+    size_t cells = (size_t)layout.width * layout.height;
+    if (cells == 0 || cells > PIXEL_MAP_MAX_CELLS)
+        return false;
+
+    // Same function the compiler uses for the built-in table, run once here
+    uint16_t *table = spareRuntimeTable();
+    uint16_t width = logicalWidth(layout);
+    for (size_t i = 0; i < cells; i++)
+    {
+        table[i] = matrixLedIndex(layout, i % width, i / width);
+    }
+    activate(table, width, logicalHeight(layout), "matrix");
+    return true;
+}
+
+static bool readMapHeader(File &file, uint8_t &width, uint8_t &height, uint16_t &count)
+{
+    uint8_t raw[PIXEL_MAP_HEADER_SIZE];
+    if (!file || file.read(raw, sizeof(raw)) != sizeof(raw) || memcmp(raw, PIXEL_MAP_MAGIC, 4) != 0)
+        return false;
+
+    width = raw[4];
+    height = raw[5];
+    count = raw[6] | (raw[7] << 8);
+    return width > 0 && height > 0 && (size_t)width * height <= PIXEL_MAP_MAX_CELLS &&
+           file.size() == PIXEL_MAP_HEADER_SIZE + count * 2;
+}
+
+bool loadPixelMap()
+{
+    File file = LittleFS.open(PIXEL_MAP_PATH, "r");
+    uint8_t width, height;
+    uint16_t count;
+    if (!readMapHeader(file, width, height, count))
+        return false;
+
+    // Invert LED -> (x, y) into the (x, y) -> LED table the effects index
+    uint16_t *table = spareRuntimeTable();
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        table[i] = PIXEL_SCRATCH;
+    }
+    for (uint16_t led = 0; led < count; led++)
+    {
+        uint8_t xy[2];
+        if (file.read(xy, sizeof(xy)) != sizeof(xy))
+            return false;
+        if (led < NUM_LEDS && xy[0] < width && xy[1] < height)
+            table[xy[1] * width + xy[0]] = led;
+    }
+    activate(table, width, height, "uploaded");
+    return true;
+}
+
+void initializePixelMap()
+{
+    // LittleFS is mounted by initializeTimeline()
+    if (!loadPixelMap())
+        useBuiltinPixelMap();
+}
+
+bool pixelMapUploadBegin()
+{
+    uploadFile.close();
+    uploadFile = LittleFS.open(PIXEL_MAP_UPLOAD_PATH, "w");
+    return uploadFile;
+}
+
+bool pixelMapUploadWrite(const uint8_t *data, size_t length)
+{
+    return uploadFile && uploadFile.write(data, length) == length;
+}
+
+bool pixelMapUploadEnd()
+{
+    if (!uploadFile)
+        return false;
+    uploadFile.close();
+
+    File file = LittleFS.open(PIXEL_MAP_UPLOAD_PATH, "r");
+    uint8_t width, height;
+    uint16_t count;
+    bool valid = readMapHeader(file, width, height, count);
+    file.close();
+    if (!valid)
+    {
+        LittleFS.remove(PIXEL_MAP_UPLOAD_PATH);
+        LOG_W("MAP", "Rejected malformed pixel map upload");
+        return false;
+    }
+
+    LittleFS.remove(PIXEL_MAP_PATH);
+    LittleFS.rename(PIXEL_MAP_UPLOAD_PATH, PIXEL_MAP_PATH);
+    return loadPixelMap();
+}
@@ -0,0 +1,199 @@
+#include "power_manager.h"
+#include "config.h"
+#include "logger.h"
+#include "led_control.h"
+#include "serial_control.h"
+#include "frame_stream.h"
+#include "command_scheduler.h"
+#include "time_sync.h"
+#include "auto_update.h"
+#include "ota_update.h"
+#include "firmware_writer.h"
+#include <WiFi.h>
+#include <esp_timer.h>
+
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/uart.h>
+#endif
+
+// Power Manager State Variables
+bool powerSaveEnabled = true;
+bool powerIdleActive = false;
+bool lightSleepAvailable = false;
+PowerStats powerStats = {};
+
+static TaskHandle_t loopTask = nullptr;
+static int64_t loopStartUs = 0;
+static unsigned long lastActivityMs = 0;
+static wifi_ps_type_t wifiSleepBeforeIdle = WIFI_PS_MIN_MODEM;
+static bool wifiSleepChanged = false;
+
+// Written by the UART event task, read by the loop task
+static portMUX_TYPE powerMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t wakeRequestUs = 0;
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t noSleepLock;
+static bool sleepLockHeld = false;
+
+// Light sleep stops the UART clock, so it is only allowed once the host
+// has gone quiet long enough to be counted as disconnected
+static void allowLightSleep(bool allow)
+{
+    if (!lightSleepAvailable || allow != sleepLockHeld)
+        return;
+    if (allow)
+        esp_pm_lock_release(noSleepLock);
+    else
+        esp_pm_lock_acquire(noSleepLock);
+    sleepLockHeld = !allow;
+}
+#endif
+
+void initializePowerManager()
+{
+    loopTask = xTaskGetCurrentTaskHandle();
+    loopStartUs = esp_timer_get_time();
+    lastActivityMs = millis();
+
+#if CONFIG_PM_ENABLE
+    // Hold the lock until the first idle period, then let the idle task
+    // sleep between loop passes. Needs a core built with tickless idle.
+    esp_pm_config_esp32_t config = {};
+    config.max_freq_mhz = getCpuFrequencyMhz();
+    config.min_freq_mhz = 80;
+    config.light_sleep_enable = true;
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "loop", &noSleepLock) == ESP_OK &&
+        esp_pm_lock_acquire(noSleepLock) == ESP_OK)
+    {
+        sleepLockHeld = true;
+        lightSleepAvailable = esp_pm_configure(&config) == ESP_OK;
+        uart_set_wakeup_threshold(UART_NUM_0, 3);
+        esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    }
+#endif
+
+    LOG_I("PWR", "Idle scheduler ready, light sleep %s", lightSleepAvailable ? "available" : "not in this build");
+}
+
+// Called from the UART receive callback - ends an idle wait right away
+void powerWake()
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&powerMux);
+    if (wakeRequestUs == 0)
+        wakeRequestUs = now;
+    portEXIT_CRITICAL(&powerMux);
+    if (loopTask)
+        xTaskNotifyGive(loopTask);
+}
+
+void notePowerActivity()
+{
+    lastActivityMs = millis();
+}
+
+// Nothing on screen changes and nothing time-critical is in flight
+static bool systemIdle()
+{
+    return powerSaveEnabled &&
+           millis() - lastActivityMs > POWER_IDLE_ENTER_MS &&
+           ledStripIdle() &&
+           !frameStreamActive() &&
+           scheduledCommandCount() == 0 &&
+           syncRole == SYNC_OFF &&
+           !updateInProgress && !otaInProgress && !firmwareWriting;
+}
+
+static void setIdle(bool idle)
+{
+    if (idle == powerIdleActive)
+        return;
+    powerIdleActive = idle;
+
+    // Deeper modem sleep only while idle. Leaving idle puts back whatever
+    // mode was set before, normally the core's default modem sleep.
+    if (idle && WiFi.status() == WL_CONNECTED)
+    {
+        wifiSleepBeforeIdle = WiFi.getSleep();
+        wifiSleepChanged = WiFi.setSleep(POWER_IDLE_WIFI_SLEEP);
+    }
+    else if (!idle && wifiSleepChanged)
+    {
+        WiFi.setSleep(wifiSleepBeforeIdle);
+        wifiSleepChanged = false;
+    }
+
+    if (idle)
+        powerStats.idleEntries++;
+    LOG_D("PWR", "%s", idle ? "Idle rate" : "Full rate");
+}
+
+// Replaces the fixed delay at the end of loop(). At full rate the loop
+// yields for a tick. When idle it waits for serial input, but no longer
+// than one frame while the web server can take requests - the polled
+// WebServer has no wake hook, so HTTP is only noticed when the wait ends.
+void powerLoopWait()
+{
+    int64_t waitStart = esp_timer_get_time();
+    powerStats.busyUs += waitStart - loopStartUs;
+
+    setIdle(systemIdle());
+    bool sleeping = lightSleepAvailable && powerIdleActive && !serialConnected;
+#if CONFIG_PM_ENABLE
+    allowLightSleep(sleeping);
+#endif
+
+    portENTER_CRITICAL(&powerMux);
+    wakeRequestUs = 0;
+    portEXIT_CRITICAL(&powerMux);
+
+    uint32_t idleWaitMs = WiFi.status() == WL_CONNECTED ? FRAME_INTERVAL_MS : POWER_IDLE_POLL_MS;
+    uint32_t woken = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(powerIdleActive ? idleWaitMs : 1));
+    loopStartUs = esp_timer_get_time();
+
+    if (!powerIdleActive)
+    {
+        powerStats.waitUs += loopStartUs - waitStart;
+        return;
+    }
+    if (sleeping)
+        powerStats.sleepUs += loopStartUs - waitStart;
+    else
+        powerStats.idleUs += loopStartUs - waitStart;
+
+    if (woken)
+    {
+        portENTER_CRITICAL(&powerMux);
+        int64_t requestUs = wakeRequestUs;
+        portEXIT_CRITICAL(&powerMux);
+
+        // Back to full rate straight away, the command that follows is
+        // rendered at the next frame boundary
+        lastActivityMs = millis();
+        setIdle(false);
+        if (requestUs != 0)
+        {
+            powerStats.wakeups++;
+            powerStats.wakeLatencyUs = loopStartUs - requestUs;
+            powerStats.wakeLatencyMaxUs = max(powerStats.wakeLatencyMaxUs, powerStats.wakeLatencyUs);
+        }
+    }
+}
+
+// Time-weighted average of the per-state figures in config.h
+uint32_t estimatedCurrentMa()
+{
+    uint64_t total = powerStats.busyUs + powerStats.waitUs + powerStats.idleUs + powerStats.sleepUs;
+    if (total == 0)
+        return 0;
+    return (powerStats.busyUs * POWER_BUSY_MA + powerStats.waitUs * POWER_WAIT_MA +
+            powerStats.idleUs * POWER_IDLE_MA + powerStats.sleepUs * POWER_SLEEP_MA) / total;
+}
+
+void resetPowerStats()
+{
+    powerStats = {};
+}
@@ -0,0 +1,83 @@
+#include "scenes.h"
+#include "config.h"
+#include "logger.h"
+#include <Preferences.h>
+
+// Stored layout is versioned so old blobs are rejected instead of misread
+struct StoredScene
+{
+    uint8_t version;
+    uint8_t mode;
+    uint8_t r, g, b;
+    uint8_t brightness;
+    uint8_t speed;
+};
+
+static const uint8_t SCENE_FORMAT_VERSION = 1;
+static const char *SCENE_NAMESPACE = "scenes";
+
+bool isValidSceneName(const String &name)
+{
+    if (name.length() == 0 || name.length() > SCENE_NAME_MAX)
+        return false;
+
+    for (unsigned int i = 0; i < name.length(); i++)
+    {
+        char c = name[i];
+        if (!isalnum(c) && c != '_' && c != '-')
+            return false;
+    }
+    return true;
+}
+
+bool saveScene(const String &name, const StripState &state)
+{
+    if (!isValidSceneName(name))
+        return false;
+
+    StoredScene stored = {SCENE_FORMAT_VERSION, (uint8_t)state.mode,
+                          state.color.r, state.color.g, state.color.b,
+                          state.brightness, state.speed};
+
+    Preferences prefs;
+    prefs.begin(SCENE_NAMESPACE, false);
+    bool ok = prefs.putBytes(name.c_str(), &stored, sizeof(stored)) == sizeof(stored);
+    prefs.end();
+
+    LOG_I("SCN", "Scene '%s' %s", name.c_str(), ok ? "saved" : "save failed");
+    return ok;
+}
+
+bool loadScene(const String &name, StripState &state)
+{
+    if (!isValidSceneName(name))
+        return false;
+
+    StoredScene stored;
+    Preferences prefs;
+    prefs.begin(SCENE_NAMESPACE, true);
+    bool ok = prefs.getBytesLength(name.c_str()) == sizeof(stored) &&
+              prefs.getBytes(name.c_str(), &stored, sizeof(stored)) == sizeof(stored);
+    prefs.end();
+
+    if (!ok || stored.version != SCENE_FORMAT_VERSION || stored.mode >= MODE_COUNT)
+        return false;
+
+    state.mode = (LedMode)stored.mode;
+    state.color = CRGB(stored.r, stored.g, stored.b);
+    state.brightness = stored.brightness;
+    state.speed = stored.speed;
+    return true;
+}
+
+bool deleteScene(const String &name)
+{
+    if (!isValidSceneName(name))
+        return false;
+
+    Preferences prefs;
+    prefs.begin(SCENE_NAMESPACE, false);
+    bool ok = prefs.remove(name.c_str());
+    prefs.end();
+    return ok;
+}
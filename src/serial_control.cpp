@@ -2,147 +2,891 @@
 #include "config.h"
 #include "led_control.h"
 #include "auto_update.h"
+#include "logger.h"
+#include "scenes.h"
+#include "timeline.h"
+#include "time_sync.h"
+#include "command_scheduler.h"
+#include "input_mailbox.h"
+#include "frame_capture.h"
+#include "pixel_map.h"
+#include "effect_vm.h"
+#include "frame_stream.h"
+#include "power_manager.h"
+#include "tempo_tracker.h"
+#include "color_kernels.h"
+#include "led_output.h"
 #include <WiFi.h>
 
 // Serial State Variables
 String serialBuffer = "";
-bool serialCommandReady = false;
 unsigned long lastSerialActivity = 0;
 bool serialConnected = false;
 
+// Baud negotiation - a new rate only sticks once the host confirms it
+static uint32_t confirmedBaud = SERIAL_BAUD_DEFAULT;
+static uint32_t pendingBaud = 0;
+static unsigned long baudDeadline = 0;
+static const uint32_t SUPPORTED_BAUDS[] = {115200, 230400, 460800, 921600, 1500000, 2000000};
+
+// Batch State - while a batch runs, individual replies fold into one summary
+static bool batchActive = false;
+static int batchErrors = 0;
+static char batchFirstError[64];
+
+// Scheduled commands run with no host waiting, so replies go to the log
+static bool scheduledActive = false;
+
+static void reply(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+static void reply(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if (batchActive)
+    {
+        char line[LOG_LINE_MAX];
+        vsnprintf(line, sizeof(line), format, args);
+        if (strncmp(line, "ERROR", 5) == 0)
+        {
+            if (batchErrors == 0)
+                snprintf(batchFirstError, sizeof(batchFirstError), "%s", line);
+            batchErrors++;
+        }
+    }
+    else if (scheduledActive)
+    {
+        char line[LOG_LINE_MAX];
+        vsnprintf(line, sizeof(line), format, args);
+        if (strncmp(line, "ERROR", 5) == 0 || strncmp(line, "BATCH ERROR", 11) == 0)
+            LOG_W("SCHED", "Scheduled command failed: %s", line);
+        else
+            LOG_D("SCHED", "%s", line);
+    }
+    else
+    {
+        sendResponseV(format, args);
+    }
+    va_end(args);
+}
+
+static void dispatchCommand(String command);
+
+// Only commands that stage strip state can be batched - anything else takes
+// effect immediately and could not be rolled back with the staged state
+static bool isBatchable(String command)
+{
+    command.toLowerCase();
+    if (command.startsWith("scene:"))
+        return !command.startsWith("scene:save:") && !command.startsWith("scene:delete:");
+
+    return command == "off" || command == "solid" || command == "rainbow" || command == "visualizer" ||
+           command == "rainbow2d" || command == "spectrum" || command == "vm" || command == "red" ||
+           command == "green" || command == "blue" || command == "yellow" || command == "white" ||
+           command.startsWith("brightness:") || command.startsWith("color:") || command.startsWith("speed:");
+}
+
+// Returns the next non-empty ';'-separated command from start onwards
+static bool nextBatchPart(const String &batch, int &start, String &part)
+{
+    int length = batch.length();
+    while (start <= length)
+    {
+        int end = batch.indexOf(';', start);
+        if (end < 0)
+            end = length;
+
+        part = batch.substring(start, end);
+        part.trim();
+        start = end + 1;
+        if (part.length() > 0)
+            return true;
+    }
+    return false;
+}
+
+// Runs ';'-separated commands back to back. Strip changes are only staged, so
+// they all land on the same frame; if any command fails the staged strip
+// state is rolled back and nothing from the batch is shown.
+static void processBatch(const String &batch)
+{
+    // Check every command before running any of them
+    int count = 0;
+    int rejected = 0;
+    String firstRejected;
+    int start = 0;
+    String part;
+    while (nextBatchPart(batch, start, part))
+    {
+        count++;
+        if (!isBatchable(part) && rejected++ == 0)
+            firstRejected = part;
+    }
+    if (rejected > 0)
+    {
+        reply("BATCH ERROR %d/%d %s cannot be batched", rejected, count, firstRejected.c_str());
+        return;
+    }
+
+    StripState snapshot = pendingState;
+    bool snapshotPending = statePending;
+
+    batchActive = true;
+    batchErrors = 0;
+    start = 0;
+    while (nextBatchPart(batch, start, part))
+        dispatchCommand(part);
+    batchActive = false;
+
+    if (batchErrors > 0)
+    {
+        pendingState = snapshot;
+        statePending = snapshotPending;
+        reply("BATCH ERROR %d/%d %s", batchErrors, count, batchFirstError);
+    }
+    else
+    {
+        reply("BATCH OK %d", count);
+    }
+}
+
+// Decodes a hex string into bytes, returns the byte count or -1 if malformed
+static int decodeHex(const String &hex, uint8_t *out, size_t capacity)
+{
+    if (hex.length() % 2 != 0 || hex.length() / 2 > capacity)
+        return -1;
+
+    for (unsigned int i = 0; i < hex.length(); i += 2)
+    {
+        char pair[3] = {hex[i], hex[i + 1], '\0'};
+        char *end;
+        out[i / 2] = strtoul(pair, &end, 16);
+        if (*end != '\0')
+            return -1;
+    }
+    return hex.length() / 2;
+}
+
+static bool isSupportedBaud(uint32_t rate)
+{
+    for (uint32_t supported : SUPPORTED_BAUDS)
+    {
+        if (rate == supported)
+            return true;
+    }
+    return false;
+}
+
+// Replies at the current rate, then switches. The host switches after the
+// reply and sends baud:ok; without it the old rate comes back.
+static void beginBaudChange(uint32_t rate)
+{
+    sendResponse("BAUD %u", (unsigned)rate);
+    logFlushAll();
+    Serial.flush();
+    Serial.updateBaudRate(rate);
+    pendingBaud = rate;
+    baudDeadline = millis() + BAUD_CONFIRM_MS;
+}
+
+static void checkBaudFallback()
+{
+    if (pendingBaud == 0 || (long)(millis() - baudDeadline) < 0)
+        return;
+
+    pendingBaud = 0;
+    Serial.updateBaudRate(confirmedBaud);
+    serialBuffer = "";
+    sendResponse("BAUD FALLBACK %u", (unsigned)confirmedBaud);
+}
+
+// Runs in the UART event task whenever bytes arrive
+static void onSerialReceive()
+{
+    powerWake();
+}
+
 void initializeSerial()
 {
-    Serial.begin(115200);
+    Serial.setRxBufferSize(SERIAL_RX_BUFFER);
+    Serial.begin(SERIAL_BAUD_DEFAULT);
+    Serial.onReceive(onSerialReceive);
     delay(1000);
 
-    Serial.println("\n=== ESP32 Music Visualizer Starting ===");
-    Serial.println("USB Serial initialized");
+    LOG_I("SER", "=== ESP32 Music Visualizer Starting ===");
+    LOG_I("SER", "USB Serial initialized");
 }
 
+// A line from the host: counts as activity on the link, then runs
 void processSerialCommand(String command)
 {
-    command.trim();
-    command.toLowerCase();
-
     // Update connection status
     lastSerialActivity = millis();
+    notePowerActivity();
     if (!serialConnected)
     {
         serialConnected = true;
-        Serial.println("RESPONSE:USB_CONNECTED");
+        reply("USB_CONNECTED");
+    }
+
+    dispatchCommand(command);
+}
+
+// A command from the scheduler: the host is not involved, so the link state
+// and idle timer are left alone and replies only go to the log
+void runScheduledCommand(const String &command)
+{
+    scheduledActive = true;
+    dispatchCommand(command);
+    scheduledActive = false;
+}
+
+static void dispatchCommand(String command)
+{
+    command.trim();
+    String rawCommand = command; // Original case, for arguments like URLs
+    command.toLowerCase();
+
+    LOG_D("SER", "Command received: %s", command.c_str());
+
+    // "@<ms>:command" runs the command when the shared clock reaches <ms>
+    if (command.startsWith("@"))
+    {
+        int separator = command.indexOf(':');
+        char *end;
+        uint32_t atMs = strtoul(command.c_str() + 1, &end, 10);
+        String scheduled = separator > 1 ? rawCommand.substring(separator + 1) : "";
+        if (scheduled.length() == 0 || !isdigit((unsigned char)command[1]) || end != command.c_str() + separator)
+            reply("ERROR Invalid schedule (@<ms>:command)");
+        else if (command.substring(separator + 1).startsWith("baud"))
+            reply("ERROR baud cannot be scheduled"); // The host has to follow a rate change
+        else if (scheduleCommand(atMs, scheduled))
+            reply("Scheduled at %u", (unsigned)atMs);
+        else
+            reply("ERROR Schedule full");
+        return;
     }
 
-    Serial.println("USB Command received: " + command);
+    // Effect programs may use ';' between statements, so they are never batches
+    if (!batchActive && command.indexOf(';') >= 0 && !command.startsWith("vm:"))
+    {
+        processBatch(rawCommand);
+        return;
+    }
 
     // Handle ping/keepalive command
     if (command == "ping")
     {
-        Serial.println("RESPONSE:PONG");
+        reply("PONG");
         return;
     }
 
     if (command == "off")
     {
-        currentMode = MODE_OFF;
-        Serial.println("RESPONSE:Strip OFF");
+        stageMode(MODE_OFF);
+        reply("Strip OFF");
     }
     else if (command == "solid")
     {
-        currentMode = MODE_SOLID;
-        Serial.println("RESPONSE:Strip Solid Color");
+        stageMode(MODE_SOLID);
+        reply("Strip Solid Color");
     }
     else if (command == "rainbow")
     {
-        currentMode = MODE_RAINBOW;
-        Serial.println("RESPONSE:Strip Rainbow");
+        stageMode(MODE_RAINBOW);
+        reply("Strip Rainbow");
     }
     else if (command == "visualizer")
     {
-        currentMode = MODE_VISUALIZER;
-        Serial.println("RESPONSE:Strip Visualizer Mode");
+        stageMode(MODE_VISUALIZER);
+        reply("Strip Visualizer Mode");
+    }
+    else if (command == "rainbow2d")
+    {
+        stageMode(MODE_RAINBOW_2D);
+        reply("Strip 2D Rainbow");
+    }
+    else if (command == "spectrum")
+    {
+        stageMode(MODE_SPECTRUM);
+        reply("Strip Spectrum");
+    }
+    else if (command == "vm")
+    {
+        stageMode(MODE_VM);
+        reply("Strip VM Program");
+    }
+    else if (command == "vm:status")
+    {
+        reply("VM instructions=%u,limit=%u,perFrame=%u,budget=%d,source=%s", vmProgram.length,
+              VM_INSTRUCTION_LIMIT, (unsigned)(vmProgram.length * NUM_LEDS), VM_FRAME_BUDGET, vmSource.c_str());
+    }
+    else if (command == "vm:bench")
+    {
+        uint32_t vmNs, rainbowNs, visualizerNs;
+        vmBenchmark(vmNs, rainbowNs, visualizerNs);
+        reply("VM ns/pixel vm=%u,rainbow=%u,visualizer=%u", (unsigned)vmNs, (unsigned)rainbowNs,
+              (unsigned)visualizerNs);
+    }
+    else if (command == "kernels:bench")
+    {
+        KernelBenchResult results[COLOR_KERNEL_COUNT];
+        uint8_t count = benchmarkColorKernels(results);
+        String line = "Kernels ns/pixel scalar/swar";
+        bool exact = true;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            line += String(i ? "," : " ") + results[i].name + "=" + String(results[i].scalarNs) + "/" +
+                    String(results[i].swarNs);
+            exact = exact && results[i].exact;
+        }
+        reply("%s exact=%d", line.c_str(), exact);
+    }
+    else if (command.startsWith("vm:"))
+    {
+        // vm:<program>, e.g. vm:h=x+t*0.2 v=beat
+        char error[48];
+        if (vmLoadProgram(command.substring(3), error, sizeof(error)))
+            reply("VM program loaded: %u instructions", vmProgram.length);
+        else
+            reply("ERROR VM %s", error);
     }
     else if (command == "red")
     {
-        currentColor = CRGB::Red;
-        if (currentMode == MODE_SOLID)
-            setStripColor(currentColor);
-        Serial.println("RESPONSE:Color Red");
+        stageColor(CRGB::Red);
+        reply("Color Red");
     }
     else if (command == "green")
     {
-        currentColor = CRGB::Green;
-        if (currentMode == MODE_SOLID)
-            setStripColor(currentColor);
-        Serial.println("RESPONSE:Color Green");
+        stageColor(CRGB::Green);
+        reply("Color Green");
     }
     else if (command == "blue")
     {
-        currentColor = CRGB::Blue;
-        if (currentMode == MODE_SOLID)
-            setStripColor(currentColor);
-        Serial.println("RESPONSE:Color Blue");
+        stageColor(CRGB::Blue);
+        reply("Color Blue");
     }
     else if (command == "yellow")
     {
-        currentColor = CRGB::Yellow;
-        if (currentMode == MODE_SOLID)
-            setStripColor(currentColor);
-        Serial.println("RESPONSE:Color Yellow");
+        stageColor(CRGB::Yellow);
+        reply("Color Yellow");
     }
     else if (command == "white")
     {
-        currentColor = CRGB::White;
-        if (currentMode == MODE_SOLID)
-            setStripColor(currentColor);
-        Serial.println("RESPONSE:Color White");
+        stageColor(CRGB::White);
+        reply("Color White");
     }
     else if (command == "ledon")
     {
         ledState = true;
         digitalWrite(BUILTIN_LED_PIN, HIGH);
-        Serial.println("RESPONSE:LED ON");
+        reply("LED ON");
     }
     else if (command == "ledoff")
     {
         ledState = false;
         digitalWrite(BUILTIN_LED_PIN, LOW);
-        Serial.println("RESPONSE:LED OFF");
+        reply("LED OFF");
     }
     else if (command == "toggle")
     {
         ledState = !ledState;
         digitalWrite(BUILTIN_LED_PIN, ledState);
-        Serial.println("RESPONSE:LED " + String(ledState ? "ON" : "OFF"));
+        reply("LED %s", ledState ? "ON" : "OFF");
     }
     else if (command == "status")
     {
         String wifiStatus = (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : "disconnected";
-        Serial.println("RESPONSE:Mode=" + String(currentMode) + ",LED=" + String(ledState) + ",WiFi=" + wifiStatus + ",USB=connected,Version=" + FIRMWARE_VERSION);
+        uint16_t bpm = tempoBpmTenths();
+        reply("Mode=%d,LED=%d,WiFi=%s,USB=connected,Version=%s,BPM=%u.%u,TempoConfidence=%u",
+              currentMode, ledState, wifiStatus.c_str(), FIRMWARE_VERSION.c_str(), bpm / 10, bpm % 10, tempoConfidence());
     }
     else if (command == "info")
     {
-        Serial.println("RESPONSE:Device=" + DEVICE_NAME + ",Version=" + FIRMWARE_VERSION + ",IP=" + WiFi.localIP().toString() + ",AutoUpdate=" + String(autoUpdateEnabled));
+        reply("Device=%s,Version=%s,IP=%s,AutoUpdate=%d", DEVICE_NAME.c_str(), FIRMWARE_VERSION.c_str(), WiFi.localIP().toString().c_str(), autoUpdateEnabled);
     }
     else if (command.startsWith("brightness:"))
     {
         int brightness = command.substring(11).toInt();
         if (brightness >= 0 && brightness <= 255)
         {
-            FastLED.setBrightness(brightness);
-            FastLED.show();
-            Serial.println("RESPONSE:Brightness set to " + String(brightness));
+            stageBrightness(brightness);
+            reply("Brightness set to %d", brightness);
+        }
+        else
+        {
+            reply("ERROR Invalid brightness (0-255)");
+        }
+    }
+    else if (command.startsWith("color:"))
+    {
+        CRGB color;
+        if (parseColor(command.substring(6), color))
+        {
+            stageColor(color);
+            reply("Color %02x%02x%02x", color.r, color.g, color.b);
+        }
+        else
+        {
+            reply("ERROR Invalid color (name or #rrggbb)");
+        }
+    }
+    else if (command.startsWith("speed:"))
+    {
+        int speed = command.substring(6).toInt();
+        if (speed >= 1 && speed <= 255)
+        {
+            stageSpeed(speed);
+            reply("Speed set to %d", speed);
+        }
+        else
+        {
+            reply("ERROR Invalid speed (1-255)");
+        }
+    }
+    else if (command.startsWith("transition:"))
+    {
+        int duration = command.substring(11).toInt();
+        if (duration >= 0 && duration <= TRANSITION_MAX_MS)
+        {
+            transitionDurationMs = duration;
+            reply("Transition set to %d ms", duration);
+        }
+        else
+        {
+            reply("ERROR Invalid transition (0-%d ms)", TRANSITION_MAX_MS);
+        }
+    }
+    else if (command.startsWith("easing:"))
+    {
+        EasingCurve curve;
+        if (parseEasing(command.substring(7), curve))
+        {
+            transitionEasing = curve;
+            reply("Easing set to %s", easingName(curve));
         }
         else
         {
-            Serial.println("RESPONSE:ERROR Invalid brightness (0-255)");
+            reply("ERROR Invalid easing (linear/quad/cubic)");
+        }
+    }
+    else if (command == "metrics")
+    {
+        reply("Frames=%u,RenderUs=%u,RenderMaxUs=%u,TransitionUs=%u,TransitionMaxUs=%u,ShowUs=%u,BudgetUs=%u",
+              (unsigned)frameMetrics.frames, (unsigned)frameMetrics.renderUs, (unsigned)frameMetrics.renderMaxUs,
+              (unsigned)frameMetrics.transitionUs, (unsigned)frameMetrics.transitionMaxUs,
+              (unsigned)frameMetrics.showUs, FRAME_INTERVAL_MS * 1000);
+    }
+    else if (command == "output")
+    {
+        reply("Output driver=%s,frames=%u,fenceWaitUs=%u,fenceWaitMaxUs=%u,transmitUs=%u,transmitMaxUs=%u,"
+              "stackFree=%u",
+              ledDriver->name, (unsigned)ledOutputStats.frames, (unsigned)ledOutputStats.fenceWaitUs,
+              (unsigned)ledOutputStats.fenceWaitMaxUs, (unsigned)ledOutputStats.transmitUs,
+              (unsigned)ledOutputStats.transmitMaxUs, (unsigned)ledOutputStats.stackFreeMin);
+    }
+    else if (command == "output:sync" || command == "output:async")
+    {
+        if (setLedDriver(command == "output:async" ? &asyncLedDriver : &syncLedDriver))
+            reply("Output %s", ledDriver->name);
+        else
+            reply("ERROR Async output unavailable, using sync");
+    }
+    else if (command == "metrics:reset")
+    {
+        resetFrameMetrics();
+        resetLedOutputStats();
+        resetInputStats();
+        reply("Metrics reset");
+    }
+    else if (command == "latency")
+    {
+        uint32_t average = inputStats.displayed ? inputStats.totalLatencyUs / inputStats.displayed : 0;
+        uint32_t elapsedMs = max(millis() - inputStats.startMs, 1UL);
+        reply("Input received=%u,coalesced=%u,displayed=%u,avgUs=%u,p50Us=%u,p99Us=%u,maxUs=%u,inputsPerSec=%u,displayedPerSec=%u",
+              (unsigned)inputStats.received, (unsigned)inputStats.coalesced, (unsigned)inputStats.displayed,
+              (unsigned)average, (unsigned)latencyPercentile(50), (unsigned)latencyPercentile(99),
+              (unsigned)inputStats.maxLatencyUs, (unsigned)(inputStats.received * 1000ULL / elapsedMs),
+              (unsigned)(inputStats.displayed * 1000ULL / elapsedMs));
+    }
+    else if (command.startsWith("timeline:"))
+    {
+        String timelineCmd = command.substring(9);
+        if (timelineCmd == "play")
+        {
+            if (timelinePlay())
+                reply("Timeline playing");
+            else
+                reply("ERROR No timeline stored");
+        }
+        else if (timelineCmd == "stop")
+        {
+            timelineStop();
+            reply("Timeline stopped at %u ms", (unsigned)timelinePositionMs);
+        }
+        else if (timelineCmd.startsWith("seek:"))
+        {
+            if (timelineSeek(timelineCmd.substring(5).toInt()))
+                reply("Timeline at %u ms", (unsigned)timelinePositionMs);
+            else
+                reply("ERROR No timeline stored");
+        }
+        else if (timelineCmd == "status")
+        {
+            reply("Timeline playing=%d,position=%u,cues=%u", timelinePlaying,
+                  (unsigned)timelinePositionMs, timelineCueCount);
+        }
+        else if (timelineCmd == "begin")
+        {
+            if (timelineUploadBegin())
+                reply("Timeline upload started");
+            else
+                reply("ERROR Could not open timeline file");
+        }
+        else if (timelineCmd.startsWith("data:"))
+        {
+            // Upload chunk as hex, e.g. timeline:data:4c544c31...
+            uint8_t chunk[SERIAL_LINE_MAX / 2];
+            int length = decodeHex(timelineCmd.substring(5), chunk, sizeof(chunk));
+            if (length >= 0 && timelineUploadWrite(chunk, length))
+            {
+                if (!quietMode)
+                    reply("Timeline data %d bytes", length);
+            }
+            else
+            {
+                reply("ERROR Invalid timeline data");
+            }
+        }
+        else if (timelineCmd == "end")
+        {
+            if (timelineUploadEnd())
+                reply("Timeline stored: %u cues", timelineCueCount);
+            else
+                reply("ERROR Invalid timeline file");
+        }
+        else
+        {
+            reply("ERROR Invalid timeline command");
+        }
+    }
+    else if (command.startsWith("map:"))
+    {
+        String mapCmd = command.substring(4);
+        if (mapCmd == "builtin")
+        {
+            useBuiltinPixelMap();
+            reply("Pixel map builtin");
+        }
+        else if (mapCmd == "load")
+        {
+            if (loadPixelMap())
+                reply("Pixel map loaded");
+            else
+                reply("ERROR No valid pixel map stored");
+        }
+        else if (mapCmd.startsWith("matrix:"))
+        {
+            // map:matrix:<w>x<h>[:s][:r<0-3>], e.g. map:matrix:16x16:s:r1
+            MatrixLayout layout = {0, 0, false, 0};
+            String spec = mapCmd.substring(7);
+            int separator = spec.indexOf('x');
+            int options = spec.indexOf(':');
+            if (separator > 0)
+            {
+                layout.width = constrain(spec.substring(0, separator).toInt(), 0, 255);
+                layout.height = constrain(spec.substring(separator + 1, options < 0 ? spec.length() : options).toInt(), 0, 255);
+            }
+            if (options >= 0)
+            {
+                String flags = spec.substring(options);
+                layout.serpentine = flags.indexOf(":s") >= 0;
+                int rotation = flags.indexOf(":r");
+                if (rotation >= 0)
+                    layout.rotation = flags.substring(rotation + 2).toInt() & 3;
+            }
+            if (buildMatrixPixelMap(layout))
+                reply("Pixel map matrix %ux%u", mapWidth, mapHeight);
+            else
+                reply("ERROR Invalid matrix layout");
+        }
+        else if (mapCmd == "status")
+        {
+            reply("Map source=%s,width=%u,height=%u,complete=%d", mapSource, mapWidth, mapHeight, mapCoversAllLeds);
+        }
+        else
+        {
+            reply("ERROR Invalid map command");
+        }
+    }
+    else if (command == "baud")
+    {
+        reply("BAUD %u", (unsigned)confirmedBaud);
+    }
+    else if (command == "baud:ok")
+    {
+        if (pendingBaud != 0)
+        {
+            confirmedBaud = pendingBaud;
+            pendingBaud = 0;
+        }
+        reply("BAUD OK %u", (unsigned)confirmedBaud);
+    }
+    else if (command.startsWith("baud:"))
+    {
+        uint32_t rate = strtoul(command.c_str() + 5, nullptr, 10);
+        if (!isSupportedBaud(rate))
+            reply("ERROR Unsupported baud rate");
+        else
+            beginBaudChange(rate);
+    }
+    else if (command == "tempo")
+    {
+        uint16_t bpm = tempoBpmTenths();
+        reply("Tempo bpm=%u.%u,confidence=%u,locked=%d,phase=%u,leadMs=%u,onsets=%u,inWindow=%u,outliers=%u,lastErrorUs=%d",
+              bpm / 10, bpm % 10, tempoConfidence(), tempoLocked(), (unsigned)(tempoPredictedPhase(frameClockMicros()) * 100UL >> 16),
+              tempoLeadMs, (unsigned)tempoStats.onsets, (unsigned)tempoStats.inWindow,
+              (unsigned)tempoStats.outliers, (int)tempoStats.lastErrorUs);
+    }
+    else if (command.startsWith("tempo:lead:"))
+    {
+        int lead = command.substring(11).toInt();
+        if (lead >= 0 && lead <= TEMPO_LEAD_MAX_MS)
+        {
+            tempoLeadMs = lead;
+            reply("Tempo lead %dms", lead);
+        }
+        else
+        {
+            reply("ERROR Invalid lead (0-%d)", TEMPO_LEAD_MAX_MS);
+        }
+    }
+    else if (command == "tempo:reset")
+    {
+        resetTempo();
+        reply("Tempo reset");
+    }
+    else if (command == "power")
+    {
+        uint64_t total = max<uint64_t>(1, powerStats.busyUs + powerStats.waitUs + powerStats.idleUs + powerStats.sleepUs);
+        reply("Power idle=%d,saving=%d,lightSleep=%d,busy=%u%%,idleTime=%u%%,sleepTime=%u%%,estMa=%u,entries=%u,wakeups=%u,wakeUs=%u,wakeMaxUs=%u",
+              powerIdleActive, powerSaveEnabled, lightSleepAvailable,
+              (unsigned)(powerStats.busyUs * 100 / total), (unsigned)(powerStats.idleUs * 100 / total),
+              (unsigned)(powerStats.sleepUs * 100 / total), (unsigned)estimatedCurrentMa(),
+              (unsigned)powerStats.idleEntries, (unsigned)powerStats.wakeups,
+              (unsigned)powerStats.wakeLatencyUs, (unsigned)powerStats.wakeLatencyMaxUs);
+    }
+    else if (command == "power:on" || command == "power:off")
+    {
+        powerSaveEnabled = command == "power:on";
+        reply("Power saving %s", powerSaveEnabled ? "on" : "off");
+    }
+    else if (command == "power:reset")
+    {
+        resetPowerStats();
+        reply("Power stats reset");
+    }
+    else if (command == "stream:stats")
+    {
+        unsigned long elapsed = max(1UL, millis() - frameStreamStats.startMs);
+        reply("Stream frames=%u,delta=%u,palette=%u,errors=%u,bytes=%u,fps=%u,bytesPerSec=%u",
+              (unsigned)frameStreamStats.frames, (unsigned)frameStreamStats.deltaFrames,
+              (unsigned)frameStreamStats.paletteFrames, (unsigned)frameStreamStats.errors,
+              (unsigned)frameStreamStats.bytes,
+              (unsigned)((uint64_t)frameStreamStats.frames * 1000 / elapsed),
+              (unsigned)((uint64_t)frameStreamStats.bytes * 1000 / elapsed));
+    }
+    else if (command == "stream:reset")
+    {
+        resetFrameStreamStats();
+        reply("Stream stats reset");
+    }
+    else if (command.startsWith("capture:"))
+    {
+        String captureCmd = command.substring(8);
+        if (captureCmd.startsWith("start:"))
+        {
+            uint32_t frames = captureCmd.substring(6).toInt();
+            if (frames > 0 && captureStart(frames))
+                reply("Capturing %u frames", (unsigned)min(frames, (uint32_t)CAPTURE_MAX_FRAMES));
+            else
+                reply("ERROR Could not start capture");
+        }
+        else if (captureCmd == "stop")
+        {
+            captureStop();
+            reply("Capture stopped: %u frames", (unsigned)captureFrameCount);
+        }
+        else if (captureCmd == "status")
+        {
+            reply("Capture active=%d,frames=%u", captureActive, (unsigned)captureFrameCount);
+        }
+        else if (captureCmd.startsWith("save:"))
+        {
+            if (captureSave(captureCmd.substring(5)))
+                reply("Golden capture saved");
+            else
+                reply("ERROR Could not save capture");
+        }
+        else if (captureCmd.startsWith("compare:"))
+        {
+            // capture:compare:<name>[:<tolerance>]
+            String name = captureCmd.substring(8);
+            int tolerance = 0;
+            int separator = name.indexOf(':');
+            if (separator >= 0)
+            {
+                tolerance = constrain(name.substring(separator + 1).toInt(), 0, 255);
+                name = name.substring(0, separator);
+            }
+
+            CaptureComparison result;
+            if (!captureCompare(name, tolerance, result))
+                reply("ERROR No capture or golden '%s'", name.c_str());
+            else if (result.mismatchedFrames == 0 && !result.lengthMismatch)
+                reply("CAPTURE MATCH frames=%u,tolerance=%d,maxDiff=%u",
+                      (unsigned)result.frames, tolerance, result.maxDiff);
+            else
+                reply("CAPTURE DIFF frames=%u,mismatched=%u,firstFrame=%u,firstPixel=%u,maxDiff=%u,lengthMismatch=%d",
+                      (unsigned)result.frames, (unsigned)result.mismatchedFrames, (unsigned)result.firstFrame,
+                      result.firstPixel, result.maxDiff, result.lengthMismatch);
+        }
+        else
+        {
+            reply("ERROR Invalid capture command");
+        }
+    }
+    else if (command == "time")
+    {
+        reply("TIME %u", (unsigned)syncedMillis());
+    }
+    else if (command == "time:us")
+    {
+        reply("TIME_US %llu", (unsigned long long)syncedMicros());
+    }
+    else if (command.startsWith("sync:"))
+    {
+        String syncCmd = command.substring(5);
+        IPAddress master;
+        if (syncCmd == "master")
+        {
+            if (startSyncMaster())
+                reply("Time sync master");
+            else
+                reply("ERROR WiFi not connected");
+        }
+        else if (syncCmd.startsWith("slave:") && master.fromString(syncCmd.substring(6).c_str()))
+        {
+            if (startSyncSlave(master))
+                reply("Time sync slave of %s", master.toString().c_str());
+            else
+                reply("ERROR WiFi not connected");
+        }
+        else if (syncCmd == "serial")
+        {
+            startSerialSync();
+            reply("Time sync over serial");
+        }
+        else if (syncCmd == "off")
+        {
+            stopTimeSync();
+            reply("Time sync off");
+        }
+        else if (syncCmd == "status")
+        {
+            reply("Sync role=%s,offsetUs=%ld,driftPpb=%ld,delayUs=%u,samples=%u,rejected=%u,time=%u,scheduled=%d",
+                  syncRoleName(syncRole), (long)syncStats.offsetUs, (long)syncStats.driftPpb,
+                  (unsigned)syncStats.delayUs, (unsigned)syncStats.samples, (unsigned)syncStats.rejected,
+                  (unsigned)syncedMillis(), scheduledCommandCount());
+        }
+        else if (handleSerialSyncReply(syncCmd))
+        {
+            // Sync replies arrive every second - no acknowledgement
+        }
+        else
+        {
+            reply("ERROR Invalid sync command");
+        }
+    }
+    else if (command == "schedule:clear")
+    {
+        clearScheduledCommands();
+        reply("Scheduled commands cleared");
+    }
+    else if (command.startsWith("scene:"))
+    {
+        String sceneCmd = command.substring(6);
+        StripState scene;
+        if (sceneCmd.startsWith("save:"))
+        {
+            // Saves the state as it will look once staged changes apply
+            String name = sceneCmd.substring(5);
+            if (saveScene(name, pendingState))
+                reply("Scene saved: %s", name.c_str());
+            else
+                reply("ERROR Could not save scene (name: 1-%d chars of a-z0-9_-)", SCENE_NAME_MAX);
+        }
+        else if (sceneCmd.startsWith("delete:"))
+        {
+            String name = sceneCmd.substring(7);
+            if (deleteScene(name))
+                reply("Scene deleted: %s", name.c_str());
+            else
+                reply("ERROR Scene not found: %s", name.c_str());
+        }
+        else if (loadScene(sceneCmd, scene))
+        {
+            stageState(scene);
+            reply("Scene recalled: %s", sceneCmd.c_str());
+        }
+        else
+        {
+            reply("ERROR Scene not found: %s", sceneCmd.c_str());
         }
     }
     else if (command.startsWith("music:"))
     {
-        // Real-time music data: "music:freq1,freq2,freq3,beat"
-        String musicData = command.substring(6);
-        handleMusicVisualization(musicData);
-        Serial.println("RESPONSE:Music data processed");
+        // Real-time music data: "music:freq1,freq2,freq3,beat". Posted to the
+        // mailbox - if several arrive between frames only the newest is drawn
+        MusicFrame frame;
+        if (parseMusicData(command.substring(6), frame))
+        {
+            postMusicFrame(frame);
+            if (!quietMode)
+                reply("Music data processed");
+        }
+        else
+        {
+            reply("ERROR Invalid music data");
+        }
+    }
+    else if (command.startsWith("log:"))
+    {
+        String logCmd = command.substring(4);
+        uint8_t level;
+        if (logCmd == "stats")
+        {
+            reply("Log level=%s,dropped=%u,quiet=%d", logLevelName(logLevel), (unsigned)logDropped, quietMode);
+        }
+        else if (parseLogLevel(logCmd, level))
+        {
+            logLevel = level;
+            reply("Log level set to %s", logLevelName(logLevel));
+        }
+        else
+        {
+            reply("ERROR Invalid log level (none/error/warn/info/debug)");
+        }
+    }
+    else if (command == "quiet:on")
+    {
+        quietMode = true;
+        reply("Quiet streaming mode ON");
+    }
+    else if (command == "quiet:off")
+    {
+        quietMode = false;
+        reply("Quiet streaming mode OFF");
     }
     else if (command.startsWith("update:"))
     {
@@ -150,53 +894,91 @@ void processSerialCommand(String command)
         if (updateCmd == "check")
         {
             checkForFirmwareUpdate();
-            Serial.println("RESPONSE:Update check initiated");
+            reply("Update check initiated");
         }
         else if (updateCmd == "enable")
         {
             autoUpdateEnabled = true;
-            Serial.println("RESPONSE:Auto-update enabled");
+            reply("Auto-update enabled");
         }
         else if (updateCmd == "disable")
         {
             autoUpdateEnabled = false;
-            Serial.println("RESPONSE:Auto-update disabled");
+            reply("Auto-update disabled");
         }
         else if (updateCmd == "now")
         {
             if (latestVersion != "" && latestVersion != ("v" + FIRMWARE_VERSION))
             {
-                checkForFirmwareUpdate(); // This will trigger the update if available
-                Serial.println("RESPONSE:Update started");
+                reply("Update started");
+                checkForFirmwareUpdate(true); // Installs even outside the rollout
             }
             else
             {
-                Serial.println("RESPONSE:No update available");
+                reply("No update available");
             }
         }
+        else if (updateCmd.startsWith("manifest:"))
+        {
+            // update:manifest:<url> or update:manifest:off to go back to GitHub
+            String url = rawCommand.substring(16);
+            if (updateCmd == "manifest:off")
+                url = "";
+            if (setManifestUrl(url))
+                reply("Update manifest %s", url.length() > 0 ? url.c_str() : "off");
+            else
+                reply("ERROR Invalid manifest URL");
+        }
+        else if (updateCmd == "status")
+        {
+            reply("Update source=%s,cohort=%u,latest=%s,status=%s",
+                  manifestUrl.length() > 0 ? manifestUrl.c_str() : "github", updateCohort,
+                  latestVersion.c_str(), updateStatus.c_str());
+        }
         else
         {
-            Serial.println("RESPONSE:ERROR Invalid update command");
+            reply("ERROR Invalid update command");
         }
     }
     else
     {
-        Serial.println("RESPONSE:ERROR Unknown command: " + command);
-        Serial.println("Available commands: ping, off, solid, rainbow, visualizer, red, green, blue, yellow, white, ledon, ledoff, toggle, status, info, brightness:0-255, music:data, update:check/enable/disable/now");
+        reply("ERROR Unknown command: %s", command.c_str());
+        LOG_I("SER", "Available commands: ping, off, solid, rainbow, visualizer, rainbow2d, spectrum, vm, vm:<program>, vm:status, vm:bench, kernels:bench, baud[:<rate>|:ok], stream:stats/reset, power[:on|:off|:reset], tempo, tempo:lead:<ms>, tempo:reset, red, green, blue, yellow, white, color:#rrggbb, ledon, ledoff, toggle, status, info, brightness:0-255, speed:1-255, scene:<name>, scene:save:<name>, scene:delete:<name>, transition:<ms>, easing:linear/quad/cubic, metrics, metrics:reset, output[:sync|:async], latency, timeline:play/stop/seek:<ms>/status/begin/data:<hex>/end, map:builtin/load/status/matrix:<w>x<h>[:s][:r<n>], capture:start:<frames>/stop/status/save:<name>/compare:<name>[:<tol>], time, time:us, sync:master/slave:<ip>/serial/off/status, @<ms>:command, schedule:clear, cmd1;cmd2;..., music:data, update:check/enable/disable/now/status/manifest:<url|off>, log:<level>, log:stats, quiet:on/off");
     }
 }
 
 void checkSerialInput()
 {
-    while (Serial.available())
+    // Handle every complete line the UART has buffered, not just one per
+    // loop, so input never queues up behind rendering. Music lines coalesce
+    // in the mailbox and control commands still run in arrival order. The
+    // byte budget is fixed on entry so a continuous stream cannot starve the loop.
+    frameStreamCheckTimeout();
+    int budget = Serial.available();
+    while (budget > 0)
     {
+        // Binary pixel frames are read in bulk by the stream decoder
+        if (frameStreamActive())
+        {
+            frameStreamRead(Serial, budget);
+            continue;
+        }
+
         char incoming = Serial.read();
+        budget--;
 
-        if (incoming == '\n' || incoming == '\r')
+        if ((uint8_t)incoming == STREAM_START_BYTE)
+        {
+            frameStreamStart();
+            lastSerialActivity = millis();
+        }
+        else if (incoming == '\n' || incoming == '\r')
         {
             if (serialBuffer.length() > 0)
             {
-                serialCommandReady = true;
+                noteSerialLine();
+                processSerialCommand(serialBuffer);
+                serialBuffer = "";
             }
         }
         else if (incoming >= 32 && incoming <= 126) // Only printable ASCII characters
@@ -204,25 +986,20 @@ void checkSerialInput()
             serialBuffer += incoming;
 
             // Prevent buffer overflow
-            if (serialBuffer.length() > 100)
+            if (serialBuffer.length() > SERIAL_LINE_MAX)
             {
-                Serial.println("RESPONSE:ERROR Command too long");
+                sendResponse("ERROR Command too long");
                 serialBuffer = "";
             }
         }
     }
 
-    if (serialCommandReady)
-    {
-        processSerialCommand(serialBuffer);
-        serialBuffer = "";
-        serialCommandReady = false;
-    }
+    checkBaudFallback();
 
     // Check for USB disconnection
     if (serialConnected && (millis() - lastSerialActivity) > SERIAL_TIMEOUT)
     {
         serialConnected = false;
-        Serial.println("RESPONSE:USB_TIMEOUT");
+        sendResponse("USB_TIMEOUT");
     }
 }
@@ -0,0 +1,171 @@
+#include "tempo_tracker.h"
+#include "config.h"
+#include "logger.h"
+#include "led_control.h"
+
+// Tempo Tracker State Variables
+uint16_t tempoLeadMs = TEMPO_LEAD_DEFAULT_MS;
+TempoStats tempoStats = {};
+
+static const uint32_t MIN_PERIOD_US = 60000000UL / TEMPO_MAX_BPM;
+static const uint32_t MAX_PERIOD_US = 60000000UL / TEMPO_MIN_BPM;
+
+// Beat model: a predicted beat at anchorUs, then one every periodUs.
+// All times are frameClockMicros(), so a simulated clock replays exactly and
+// units sharing a synced clock agree; compared through signed differences.
+static uint32_t periodUs = 0; // 0 until two onsets give a first estimate
+static uint32_t anchorUs = 0;
+static int confidence = 0;    // 0-100
+static uint32_t lastOnsetUs = 0;
+static bool haveOnset = false;
+
+// Onset detection state for level-style music: input
+static uint8_t lastBeatLevel = 0;
+static uint32_t lastFrameUs = 0;
+
+// Half- and double-time intervals are folded into the tracked BPM range
+static uint32_t foldPeriod(uint32_t intervalUs)
+{
+    while (intervalUs < MIN_PERIOD_US)
+        intervalUs *= 2;
+    while (intervalUs > MAX_PERIOD_US)
+        intervalUs /= 2;
+    return intervalUs;
+}
+
+static void seedFromInterval(uint32_t timeUs)
+{
+    uint32_t interval = timeUs - lastOnsetUs;
+    if (!haveOnset || interval < MIN_PERIOD_US / 2 || interval > MAX_PERIOD_US * 2)
+        return;
+    periodUs = foldPeriod(interval);
+    anchorUs = timeUs;
+    confidence = TEMPO_CONFIDENCE_STEP;
+}
+
+void tempoOnset(uint32_t timeUs, uint8_t level)
+{
+    tempoStats.onsets++;
+    tempoStats.lastLevel = level;
+
+    // After a long silence the old beat grid means nothing
+    if (periodUs != 0 && timeUs - lastOnsetUs > periodUs * TEMPO_HOLD_BEATS * 2)
+    {
+        periodUs = 0;
+        confidence = 0;
+    }
+
+    if (periodUs == 0)
+    {
+        seedFromInterval(timeUs);
+    }
+    else
+    {
+        // Phase error against the nearest predicted beat, within +-period/2
+        int32_t since = (int32_t)(timeUs - anchorUs);
+        int32_t rounded = since + (int32_t)periodUs / 2;
+        int32_t beats = rounded / (int32_t)periodUs;
+        if (rounded % (int32_t)periodUs < 0)
+            beats--; // Floor, not truncation, before the anchor
+        anchorUs += beats * (int32_t)periodUs;
+        int32_t error = (int32_t)(timeUs - anchorUs);
+        tempoStats.lastErrorUs = error;
+
+        if ((uint32_t)abs(error) <= periodUs * TEMPO_LOCK_WINDOW / 100)
+        {
+            // Second-order loop: phase follows quickly, tempo slowly
+            anchorUs += error / TEMPO_PHASE_GAIN;
+            periodUs = constrain((int32_t)periodUs + error / TEMPO_PERIOD_GAIN,
+                                 (int32_t)MIN_PERIOD_US, (int32_t)MAX_PERIOD_US);
+            confidence = min(100, confidence + TEMPO_CONFIDENCE_STEP);
+            tempoStats.inWindow++;
+        }
+        else
+        {
+            tempoStats.outliers++;
+            confidence -= TEMPO_CONFIDENCE_STEP * 2;
+            if (confidence <= 0)
+            {
+                // Lock lost, start again from this interval
+                periodUs = 0;
+                confidence = 0;
+                seedFromInterval(timeUs);
+                LOG_D("TEMPO", "Lock lost, reseeded at %u us", (unsigned)periodUs);
+            }
+        }
+    }
+
+    lastOnsetUs = timeUs;
+    haveOnset = true;
+}
+
+// music: frames carry a beat level rather than discrete events. A rising
+// edge is an onset, and so is any strong frame after a gap, for hosts that
+// only send on beats.
+void tempoFeedMusic(const MusicFrame &frame)
+{
+    // Frames are fed as they arrive, so the frame clock now is the arrival
+    // time; receivedUs stays on micros() for the latency metrics
+    uint32_t timeUs = frameClockMicros();
+    bool strong = frame.beat >= TEMPO_ONSET_LEVEL;
+    bool rearmed = lastBeatLevel < TEMPO_ONSET_LEVEL / 2 ||
+                   timeUs - lastFrameUs > TEMPO_REARM_MS * 1000UL;
+    bool debounced = !haveOnset || timeUs - lastOnsetUs > MIN_PERIOD_US / 2;
+
+    if (strong && rearmed && debounced)
+        tempoOnset(timeUs, frame.beat);
+
+    lastBeatLevel = frame.beat;
+    lastFrameUs = timeUs;
+}
+
+// Position within the current beat, 0-65535, 0 = on the beat
+uint16_t tempoPhaseAt(uint32_t timeUs)
+{
+    if (periodUs == 0)
+        return 0;
+    int32_t since = (int32_t)(timeUs - anchorUs) % (int32_t)periodUs;
+    if (since < 0)
+        since += periodUs;
+    return ((uint64_t)since << 16) / periodUs;
+}
+
+// Phase the strip should show now: inputs arrive tempoLeadMs after the
+// music, so rendering that far ahead puts beats back on the music
+uint16_t tempoPredictedPhase(uint32_t frameUs)
+{
+    return tempoPhaseAt(frameUs + tempoLeadMs * 1000UL);
+}
+
+// Confidence fades once onsets stop, so a stopped track unlocks
+uint8_t tempoConfidence()
+{
+    if (!haveOnset || periodUs == 0)
+        return 0;
+    uint32_t silentUs = frameClockMicros() - lastOnsetUs;
+    uint32_t holdUs = periodUs * TEMPO_HOLD_BEATS;
+    if (silentUs > holdUs * 2)
+        return 0;
+    if (silentUs > holdUs)
+        return confidence * (holdUs * 2 - silentUs) / holdUs;
+    return confidence;
+}
+
+bool tempoLocked()
+{
+    return tempoConfidence() >= TEMPO_LOCK_CONFIDENCE;
+}
+
+uint16_t tempoBpmTenths()
+{
+    return periodUs ? 600000000ULL / periodUs : 0;
+}
+
+void resetTempo()
+{
+    periodUs = 0;
+    confidence = 0;
+    haveOnset = false;
+    lastBeatLevel = 0;
+    tempoStats = {};
+}
@@ -0,0 +1,284 @@
+#include "time_sync.h"
+#include "config.h"
+#include "logger.h"
+#include <AsyncUDP.h>
+#include <esp_timer.h>
+
+// Time Sync State Variables
+SyncRole syncRole = SYNC_OFF;
+SyncStats syncStats = {};
+
+// Sync packet, identical layout on every unit (all little endian ESP32s)
+struct __attribute__((packed)) SyncPacket
+{
+    char magic[2]; // "TS"
+    uint8_t type;
+    uint8_t reserved;
+    int64_t t0; // Slave local time when the request left
+    int64_t t1; // Master time when the request arrived
+    int64_t t2; // Master time when the reply left
+};
+
+static const uint8_t SYNC_PACKET_REQUEST = 1;
+static const uint8_t SYNC_PACKET_REPLY = 2;
+
+// Clock model: synced = local + baseOffset + drift * (local - baseLocal)
+static int64_t baseLocalUs = 0;
+static int64_t baseOffsetUs = 0;
+static int64_t lastSampleLocalUs = 0;
+
+// Delay filter - only samples close to the best recent round trip are used,
+// since queueing delay is what makes a sample asymmetric
+static int64_t recentDelays[SYNC_FILTER_SIZE];
+static uint8_t recentDelayCount = 0;
+static uint8_t recentDelayIndex = 0;
+
+static AsyncUDP syncUdp;
+static bool udpListening = false;
+static IPAddress syncMaster;
+static unsigned long lastRequestMs = 0;
+static int64_t serialRequestT0 = 0;
+
+// Filled by the UDP callback, which runs outside the loop task
+static portMUX_TYPE syncMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t pendingSample[4];
+static bool pendingSampleReady = false;
+
+// When loop() read the end of the current serial line
+static int64_t serialLineUs = 0;
+
+static int64_t toSynced(int64_t localUs)
+{
+    return localUs + baseOffsetUs + (localUs - baseLocalUs) * syncStats.driftPpb / 1000000000LL;
+}
+
+uint64_t syncedMicros()
+{
+    return toSynced(esp_timer_get_time());
+}
+
+uint32_t syncedMillis()
+{
+    return syncedMicros() / 1000;
+}
+
+static void resetFilter()
+{
+    recentDelayCount = 0;
+    recentDelayIndex = 0;
+    syncStats.samples = 0;
+    syncStats.rejected = 0;
+}
+
+// Standard four-timestamp exchange: t0/t3 on the local clock, t1/t2 on the master's
+static void processSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3)
+{
+    int64_t delay = max((int64_t)0, (t3 - t0) - (t2 - t1));
+    int64_t offset = ((t1 - t0) + (t2 - t3)) / 2;
+
+    recentDelays[recentDelayIndex] = delay;
+    recentDelayIndex = (recentDelayIndex + 1) % SYNC_FILTER_SIZE;
+    recentDelayCount = min((int)recentDelayCount + 1, SYNC_FILTER_SIZE);
+
+    int64_t bestDelay = delay;
+    for (uint8_t i = 0; i < recentDelayCount; i++)
+    {
+        bestDelay = min(bestDelay, recentDelays[i]);
+    }
+    if (delay > bestDelay + SYNC_DELAY_TOLERANCE_US)
+    {
+        syncStats.rejected++;
+        return;
+    }
+
+    int64_t local = (t0 + t3) / 2;
+    int64_t error = offset - (toSynced(local) - local);
+
+    if (syncStats.samples == 0 || llabs(error) > SYNC_STEP_THRESHOLD_US)
+    {
+        // First sample or a large jump - step straight onto the master
+        baseLocalUs = local;
+        baseOffsetUs = offset;
+        syncStats.driftPpb = 0;
+        LOG_I("SYNC", "Clock stepped by %ld us", (long)error);
+    }
+    else
+    {
+        // Slew: take half the phase error now and a quarter of the implied
+        // rate error into the drift term, like a simple PLL/FLL loop
+        int64_t elapsed = local - lastSampleLocalUs;
+        int64_t predicted = toSynced(local) - local;
+        if (elapsed > 0)
+        {
+            int64_t drift = syncStats.driftPpb + error * 1000000000LL / elapsed / 4;
+            syncStats.driftPpb = constrain(drift, (int64_t)-500000, (int64_t)500000);
+        }
+        baseLocalUs = local;
+        baseOffsetUs = predicted + error / 2;
+    }
+
+    lastSampleLocalUs = local;
+    syncStats.samples++;
+    syncStats.offsetUs = baseOffsetUs;
+    syncStats.delayUs = delay;
+    syncStats.lastSyncMs = millis();
+    LOG_D("SYNC", "offset=%ld us error=%ld us delay=%ld us", (long)offset, (long)error, (long)delay);
+}
+
+static void onSyncPacket(AsyncUDPPacket &packet)
+{
+    int64_t arrival = esp_timer_get_time();
+    SyncPacket message;
+    if (packet.length() != sizeof(message))
+        return;
+
+    memcpy(&message, packet.data(), sizeof(message));
+    if (message.magic[0] != 'T' || message.magic[1] != 'S')
+        return;
+
+    if (message.type == SYNC_PACKET_REQUEST && syncRole == SYNC_MASTER)
+    {
+        // Reply from the callback so queueing in loop() never adds delay
+        message.type = SYNC_PACKET_REPLY;
+        message.t1 = toSynced(arrival);
+        message.t2 = toSynced(esp_timer_get_time());
+        packet.write((const uint8_t *)&message, sizeof(message));
+    }
+    else if (message.type == SYNC_PACKET_REPLY && syncRole == SYNC_SLAVE)
+    {
+        portENTER_CRITICAL(&syncMux);
+        pendingSample[0] = message.t0;
+        pendingSample[1] = message.t1;
+        pendingSample[2] = message.t2;
+        pendingSample[3] = arrival;
+        pendingSampleReady = true;
+        portEXIT_CRITICAL(&syncMux);
+    }
+}
+
+static bool listenUdp()
+{
+    if (!udpListening && WiFi.status() == WL_CONNECTED)
+    {
+        udpListening = syncUdp.listen(SYNC_PORT);
+        if (udpListening)
+            syncUdp.onPacket(onSyncPacket);
+    }
+    return udpListening;
+}
+
+bool startSyncMaster()
+{
+    if (!listenUdp())
+        return false;
+
+    // Keep the current clock model so a unit promoted to master doesn't jump
+    syncRole = SYNC_MASTER;
+    LOG_I("SYNC", "Time sync master on UDP port %d", SYNC_PORT);
+    return true;
+}
+
+bool startSyncSlave(const IPAddress &master)
+{
+    if (!listenUdp())
+        return false;
+
+    syncMaster = master;
+    resetFilter();
+    syncRole = SYNC_SLAVE;
+    lastRequestMs = 0;
+    LOG_I("SYNC", "Following time master %s", master.toString().c_str());
+    return true;
+}
+
+void startSerialSync()
+{
+    resetFilter();
+    syncRole = SYNC_SERIAL;
+    lastRequestMs = 0;
+}
+
+void stopTimeSync()
+{
+    // The clock model is kept, so effects keep running from the last estimate
+    syncRole = SYNC_OFF;
+}
+
+void noteSerialLine()
+{
+    serialLineUs = esp_timer_get_time();
+}
+
+bool handleSerialSyncReply(const String &args)
+{
+    // "t0,t1,t2" - t0 echoed from SYNC_REQ, t1/t2 on the host clock
+    if (syncRole != SYNC_SERIAL)
+        return false;
+
+    char *cursor;
+    int64_t t0 = strtoll(args.c_str(), &cursor, 10);
+    if (*cursor != ',')
+        return false;
+    int64_t t1 = strtoll(cursor + 1, &cursor, 10);
+    if (*cursor != ',')
+        return false;
+    int64_t t2 = strtoll(cursor + 1, &cursor, 10);
+    if (*cursor != '\0' || t0 != serialRequestT0)
+        return false;
+
+    // t3 is when this reply's line was read, so any wait for loop() only
+    // lengthens the round trip and the delay filter drops the sample
+    processSample(t0, t1, t2, serialLineUs);
+    return true;
+}
+
+void handleTimeSync()
+{
+    if (pendingSampleReady)
+    {
+        int64_t sample[4];
+        portENTER_CRITICAL(&syncMux);
+        memcpy(sample, pendingSample, sizeof(sample));
+        pendingSampleReady = false;
+        portEXIT_CRITICAL(&syncMux);
+        processSample(sample[0], sample[1], sample[2], sample[3]);
+    }
+
+    if (syncRole != SYNC_SLAVE && syncRole != SYNC_SERIAL)
+        return;
+    if (millis() - lastRequestMs < SYNC_INTERVAL_MS)
+        return;
+
+    if (syncRole == SYNC_SLAVE)
+    {
+        SyncPacket request = {{'T', 'S'}, SYNC_PACKET_REQUEST, 0, esp_timer_get_time(), 0, 0};
+        syncUdp.writeTo((const uint8_t *)&request, sizeof(request), syncMaster, SYNC_PORT);
+    }
+    else
+    {
+        // Only sent with nothing queued ahead of it, so the non-blocking
+        // flush puts it on the wire as it is stamped. Otherwise retry on
+        // the next pass.
+        if (logOutputPending())
+            return;
+        serialRequestT0 = esp_timer_get_time();
+        sendResponse("SYNC_REQ %lld", (long long)serialRequestT0);
+        logFlush();
+    }
+    lastRequestMs = millis();
+}
+
+const char *syncRoleName(SyncRole role)
+{
+    switch (role)
+    {
+    case SYNC_MASTER:
+        return "master";
+    case SYNC_SLAVE:
+        return "slave";
+    case SYNC_SERIAL:
+        return "serial";
+    default:
+        return "off";
+    }
+}
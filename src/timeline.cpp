@@ -0,0 +1,357 @@
+#include "timeline.h"
+#include "config.h"
+#include "led_control.h"
+#include "logger.h"
+#include <LittleFS.h>
+
+// Timeline State Variables
+bool timelinePlaying = false;
+uint32_t timelinePositionMs = 0;
+uint16_t timelineCueCount = 0;
+
+// File layout (little endian):
+//   header: "LTL1", u8 flags (bit 0 = loop), u8 reserved, u16 cue count
+//   cue:    u32 time ms, u8 type, u16 payload length, payload
+static const uint8_t TIMELINE_MAGIC[4] = {'L', 'T', 'L', '1'};
+static const size_t TIMELINE_HEADER_SIZE = 8;
+static const size_t CUE_HEADER_SIZE = 7;
+static const uint8_t TIMELINE_FLAG_LOOP = 0x01;
+
+struct CueHeader
+{
+    uint32_t timeMs;
+    uint8_t type;
+    uint16_t length;
+};
+
+// Buffered sequential reader so cues and keyframes stream from flash in
+// TIMELINE_READAHEAD sized reads instead of being loaded whole
+struct CueReader
+{
+    File file;
+    uint8_t buffer[TIMELINE_READAHEAD];
+    size_t bufferStart; // File offset of buffer[0]
+    size_t length;      // Valid bytes in buffer
+    size_t pos;         // Read index within buffer
+};
+
+static CueReader reader;
+static CueHeader nextCue;
+static bool haveNextCue = false;
+static bool loopPlayback = false;
+static uint32_t lastCueMs = 0; // Time of the last cue applied, the loop length once the end is reached
+static unsigned long playStartMs = 0;
+static File uploadFile;
+
+static bool readerFill()
+{
+    reader.bufferStart += reader.length;
+    int got = reader.file.read(reader.buffer, sizeof(reader.buffer));
+    reader.length = got > 0 ? got : 0;
+    reader.pos = 0;
+    return reader.length > 0;
+}
+
+static bool readerRead(void *destination, size_t count)
+{
+    uint8_t *out = (uint8_t *)destination;
+    while (count > 0)
+    {
+        if (reader.pos == reader.length && !readerFill())
+            return false;
+
+        size_t chunk = min(count, reader.length - reader.pos);
+        memcpy(out, reader.buffer + reader.pos, chunk);
+        reader.pos += chunk;
+        out += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+static size_t readerOffset()
+{
+    return reader.bufferStart + reader.pos;
+}
+
+static bool readerSeek(size_t offset)
+{
+    if (offset >= reader.bufferStart && offset <= reader.bufferStart + reader.length)
+    {
+        reader.pos = offset - reader.bufferStart;
+        return true;
+    }
+    if (!reader.file.seek(offset))
+        return false;
+    reader.bufferStart = offset;
+    reader.length = 0;
+    reader.pos = 0;
+    return true;
+}
+
+static bool readHeader(File &file, uint8_t &flags, uint16_t &cueCount)
+{
+    uint8_t raw[TIMELINE_HEADER_SIZE];
+    if (file.read(raw, sizeof(raw)) != sizeof(raw) || memcmp(raw, TIMELINE_MAGIC, 4) != 0)
+        return false;
+    flags = raw[4];
+    cueCount = raw[6] | (raw[7] << 8);
+    return true;
+}
+
+static bool readCueHeader(CueHeader &cue)
+{
+    uint8_t raw[CUE_HEADER_SIZE];
+    if (!readerRead(raw, sizeof(raw)))
+        return false;
+    cue.timeMs = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((uint32_t)raw[3] << 24);
+    cue.type = raw[4];
+    cue.length = raw[5] | (raw[6] << 8);
+    return true;
+}
+
+// Streams keyframe pixels from flash straight into pixelFrame[]
+static void loadKeyframe(uint16_t length)
+{
+    size_t pixels = min((size_t)(length / 3), (size_t)NUM_LEDS);
+    readerRead(pixelFrame, pixels * 3);
+    fill_solid(pixelFrame + pixels, NUM_LEDS - pixels, CRGB::Black);
+}
+
+// Applies one cue to state. The payload is always consumed in full, so
+// unknown cue types and oversized payloads are skipped safely.
+static void applyCue(const CueHeader &cue, StripState &state, bool showKeyframes)
+{
+    size_t payloadStart = readerOffset();
+    uint8_t value[3];
+
+    switch (cue.type)
+    {
+    case CUE_MODE:
+        if (cue.length >= 1 && readerRead(value, 1) && value[0] < MODE_COUNT)
+            state.mode = (LedMode)value[0];
+        break;
+    case CUE_COLOR:
+        if (cue.length >= 3 && readerRead(value, 3))
+            state.color = CRGB(value[0], value[1], value[2]);
+        break;
+    case CUE_BRIGHTNESS:
+        if (cue.length >= 1 && readerRead(value, 1))
+            state.brightness = value[0];
+        break;
+    case CUE_SPEED:
+        if (cue.length >= 1 && readerRead(value, 1) && value[0] > 0)
+            state.speed = value[0];
+        break;
+    case CUE_KEYFRAME:
+        if (showKeyframes)
+            loadKeyframe(cue.length);
+        state.mode = MODE_PIXELS;
+        break;
+    }
+
+    readerSeek(payloadStart + cue.length);
+}
+
+void initializeTimeline()
+{
+    if (!LittleFS.begin(true))
+    {
+        LOG_E("TL", "LittleFS mount failed, timelines unavailable");
+        return;
+    }
+
+    File file = LittleFS.open(TIMELINE_PATH, "r");
+    uint8_t flags;
+    if (file && readHeader(file, flags, timelineCueCount))
+        LOG_I("TL", "Timeline loaded: %u cues", timelineCueCount);
+    file.close();
+}
+
+bool timelineAvailable()
+{
+    return LittleFS.exists(TIMELINE_PATH);
+}
+
+bool timelineSeek(uint32_t positionMs)
+{
+    reader.file.close();
+    reader.file = LittleFS.open(TIMELINE_PATH, "r");
+    reader.bufferStart = TIMELINE_HEADER_SIZE;
+    reader.length = 0;
+    reader.pos = 0;
+
+    uint8_t flags;
+    if (!reader.file || !readHeader(reader.file, flags, timelineCueCount))
+    {
+        timelinePlaying = false;
+        return false;
+    }
+    loopPlayback = flags & TIMELINE_FLAG_LOOP;
+
+    // Replay state cues up to the seek point without touching the strip,
+    // remembering only the last keyframe so it is read from flash once
+    StripState state = pendingState;
+    size_t keyframeOffset = 0;
+    uint16_t keyframeLength = 0;
+    CueHeader cue;
+
+    haveNextCue = false;
+    lastCueMs = 0;
+    while (readCueHeader(cue))
+    {
+        if (cue.timeMs > positionMs)
+        {
+            nextCue = cue;
+            haveNextCue = true;
+            break;
+        }
+        if (cue.type == CUE_KEYFRAME)
+        {
+            keyframeOffset = readerOffset();
+            keyframeLength = cue.length;
+        }
+        applyCue(cue, state, false);
+        lastCueMs = cue.timeMs;
+    }
+
+    if (keyframeOffset > 0)
+    {
+        size_t resume = readerOffset();
+        readerSeek(keyframeOffset);
+        loadKeyframe(keyframeLength);
+        readerSeek(resume);
+    }
+
+    stageState(state);
+    timelinePositionMs = positionMs;
+    playStartMs = frameClockMillis() - positionMs;
+    return true;
+}
+
+bool timelinePlay()
+{
+    if (!timelineSeek(timelinePositionMs))
+        return false;
+    timelinePlaying = true;
+    LOG_I("TL", "Timeline playing from %u ms", (unsigned)timelinePositionMs);
+    return true;
+}
+
+void timelineStop()
+{
+    timelinePlaying = false;
+    reader.file.close();
+    LOG_I("TL", "Timeline stopped at %u ms", (unsigned)timelinePositionMs);
+}
+
+void timelineTick(unsigned long frameTime)
+{
+    if (!timelinePlaying)
+        return;
+
+    timelinePositionMs = frameTime - playStartMs;
+
+    StripState state = pendingState;
+    bool changed = false;
+    while (haveNextCue && nextCue.timeMs <= timelinePositionMs)
+    {
+        applyCue(nextCue, state, true);
+        lastCueMs = nextCue.timeMs;
+        changed = true;
+        haveNextCue = readCueHeader(nextCue);
+    }
+    if (changed)
+        stageState(state);
+
+    if (!haveNextCue)
+    {
+        // The last cue's state shows on this frame and the loop restarts on
+        // the next one. A loop whose cues all sit at 0 ms would re-seek every
+        // frame, so it plays once instead.
+        if (loopPlayback && lastCueMs > 0)
+        {
+            if (changed)
+                return;
+            timelineSeek(0);
+            playStartMs = frameTime;
+        }
+        else
+        {
+            if (loopPlayback)
+                LOG_W("TL", "Looping timeline has no cue after 0 ms, playing once");
+            timelineStop();
+            timelinePositionMs = 0;
+        }
+    }
+}
+
+bool timelineUploadBegin()
+{
+    uploadFile.close();
+    uploadFile = LittleFS.open(TIMELINE_UPLOAD_PATH, "w");
+    return uploadFile;
+}
+
+bool timelineUploadWrite(const uint8_t *data, size_t length)
+{
+    return uploadFile && uploadFile.write(data, length) == length;
+}
+
+// Walks every cue header to make sure the file is well formed before it
+// replaces the active timeline
+static bool validateTimeline(const char *path, uint16_t &cueCount)
+{
+    File file = LittleFS.open(path, "r");
+    uint8_t flags;
+    if (!file || !readHeader(file, flags, cueCount))
+        return false;
+
+    size_t offset = TIMELINE_HEADER_SIZE;
+    size_t size = file.size();
+    uint32_t lastTime = 0;
+    for (uint16_t i = 0; i < cueCount; i++)
+    {
+        uint8_t raw[CUE_HEADER_SIZE];
+        if (!file.seek(offset) || file.read(raw, sizeof(raw)) != sizeof(raw))
+            return false;
+
+        uint32_t timeMs = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((uint32_t)raw[3] << 24);
+        uint16_t length = raw[5] | (raw[6] << 8);
+        if (timeMs < lastTime)
+            return false;
+
+        lastTime = timeMs;
+        offset += CUE_HEADER_SIZE + length;
+    }
+    // A loop needs a positive length, the time of its last cue
+    if ((flags & TIMELINE_FLAG_LOOP) && lastTime == 0)
+        return false;
+    return offset == size;
+}
+
+bool timelineUploadEnd()
+{
+    if (!uploadFile)
+        return false;
+    uploadFile.close();
+
+    uint16_t cueCount;
+    if (!validateTimeline(TIMELINE_UPLOAD_PATH, cueCount))
+    {
+        LittleFS.remove(TIMELINE_UPLOAD_PATH);
+        LOG_W("TL", "Rejected malformed timeline upload");
+        return false;
+    }
+
+    if (timelinePlaying)
+        timelineStop();
+    reader.file.close();
+
+    LittleFS.remove(TIMELINE_PATH);
+    LittleFS.rename(TIMELINE_UPLOAD_PATH, TIMELINE_PATH);
+    timelineCueCount = cueCount;
+    timelinePositionMs = 0;
+    LOG_I("TL", "Timeline stored: %u cues", cueCount);
+    return true;
+}
@@ -3,28 +3,57 @@
 #include "led_control.h"
 #include "ota_update.h"
 #include "auto_update.h"
+#include "logger.h"
+#include "scenes.h"
+#include "timeline.h"
+#include "frame_capture.h"
+#include "firmware_writer.h"
+#include "pixel_map.h"
+#include "effect_vm.h"
+#include "command_scheduler.h"
+#include "input_mailbox.h"
+#include "power_manager.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <LittleFS.h>
 
 // Web Server Instance
 WebServer server(80);
 
+// Any request counts as activity, like a serial line, so the idle scheduler
+// never drops the loop rate while a client drives the strip over HTTP
+static WebServer::THandlerFunction withActivity(void (*handler)())
+{
+    return [handler]()
+    {
+        notePowerActivity();
+        handler();
+    };
+}
+
 void initializeWebServer()
 {
     // Setup web server routes
-    server.on("/", handleRoot);
-    server.on("/led/on", handleLedOn);
-    server.on("/led/off", handleLedOff);
-    server.on("/led/toggle", handleLedToggle);
-    server.on("/strip/mode/*", handleStripMode);
-    server.on("/strip/color/*", handleStripColor);
-    server.on("/auto-update/*", handleAutoUpdateWeb);
-    server.on("/api/music", HTTP_POST, handleMusicData);
-    server.on("/music/data", handleMusicData);
+    server.on("/", withActivity(handleRoot));
+    server.on("/led/on", withActivity(handleLedOn));
+    server.on("/led/off", withActivity(handleLedOff));
+    server.on("/led/toggle", withActivity(handleLedToggle));
+    server.on("/strip/mode/*", withActivity(handleStripMode));
+    server.on("/strip/color/*", withActivity(handleStripColor));
+    server.on("/auto-update/*", withActivity(handleAutoUpdateWeb));
+    server.on("/api/music", HTTP_POST, withActivity(handleMusicData));
+    server.on("/music/data", withActivity(handleMusicData));
+    server.on("/api/state", withActivity(handleStateApi));
+    server.on("/api/timeline", HTTP_POST, withActivity(handleTimelineUploadDone), withActivity(handleTimelineUpload));
+    server.on("/timeline/*", withActivity(handleTimelineWeb));
+    server.on("/api/capture", HTTP_GET, withActivity(handleCaptureDownload));
+    server.on("/update", HTTP_POST, withActivity(handleFirmwareUploadDone), withActivity(handleFirmwareUpload));
+    server.on("/api/pixelmap", HTTP_POST, withActivity(handlePixelMapUploadDone), withActivity(handlePixelMapUpload));
+    server.on("/api/effect", withActivity(handleEffectApi));
 
     server.begin();
-    Serial.println("Web server started!");
+    LOG_I("WEB", "Web server started!");
 }
 
 void handleRoot()
@@ -119,7 +148,7 @@ void handleLedOn()
     ledState = true;
     digitalWrite(BUILTIN_LED_PIN, HIGH);
     server.send(200, "text/plain", "LED ON");
-    Serial.println("LED turned ON");
+    LOG_D("WEB", "LED turned ON");
 }
 
 void handleLedOff()
@@ -127,7 +156,7 @@ void handleLedOff()
     ledState = false;
     digitalWrite(BUILTIN_LED_PIN, LOW);
     server.send(200, "text/plain", "LED OFF");
-    Serial.println("LED turned OFF");
+    LOG_D("WEB", "LED turned OFF");
 }
 
 void handleLedToggle()
@@ -135,7 +164,7 @@ void handleLedToggle()
     ledState = !ledState;
     digitalWrite(BUILTIN_LED_PIN, ledState);
     server.send(200, "text/plain", ledState ? "LED ON" : "LED OFF");
-    Serial.println("LED toggled to: " + String(ledState ? "ON" : "OFF"));
+    LOG_D("WEB", "LED toggled to: %s", ledState ? "ON" : "OFF");
 }
 
 void handleStripMode()
@@ -144,27 +173,45 @@ void handleStripMode()
 
     if (mode == "off")
     {
-        currentMode = MODE_OFF;
+        stageMode(MODE_OFF);
         server.send(200, "text/plain", "Strip OFF");
-        Serial.println("LED Strip: OFF");
+        LOG_D("WEB", "LED Strip: OFF");
     }
     else if (mode == "solid")
     {
-        currentMode = MODE_SOLID;
+        stageMode(MODE_SOLID);
         server.send(200, "text/plain", "Strip Solid Color");
-        Serial.println("LED Strip: Solid Color");
+        LOG_D("WEB", "LED Strip: Solid Color");
     }
     else if (mode == "rainbow")
     {
-        currentMode = MODE_RAINBOW;
+        stageMode(MODE_RAINBOW);
         server.send(200, "text/plain", "Strip Rainbow");
-        Serial.println("LED Strip: Rainbow Mode");
+        LOG_D("WEB", "LED Strip: Rainbow Mode");
     }
     else if (mode == "visualizer")
     {
-        currentMode = MODE_VISUALIZER;
+        stageMode(MODE_VISUALIZER);
         server.send(200, "text/plain", "Strip Visualizer Mode");
-        Serial.println("LED Strip: Visualizer Mode");
+        LOG_D("WEB", "LED Strip: Visualizer Mode");
+    }
+    else if (mode == "rainbow2d")
+    {
+        stageMode(MODE_RAINBOW_2D);
+        server.send(200, "text/plain", "Strip 2D Rainbow");
+        LOG_D("WEB", "LED Strip: 2D Rainbow Mode");
+    }
+    else if (mode == "spectrum")
+    {
+        stageMode(MODE_SPECTRUM);
+        server.send(200, "text/plain", "Strip Spectrum");
+        LOG_D("WEB", "LED Strip: Spectrum Mode");
+    }
+    else if (mode == "vm")
+    {
+        stageMode(MODE_VM);
+        server.send(200, "text/plain", "Strip VM Program");
+        LOG_D("WEB", "LED Strip: VM Mode");
     }
     else
     {
@@ -175,40 +222,17 @@ void handleStripMode()
 void handleStripColor()
 {
     String color = server.pathArg(0);
+    CRGB value;
 
-    if (color == "red")
-    {
-        currentColor = CRGB::Red;
-    }
-    else if (color == "green")
-    {
-        currentColor = CRGB::Green;
-    }
-    else if (color == "blue")
-    {
-        currentColor = CRGB::Blue;
-    }
-    else if (color == "yellow")
-    {
-        currentColor = CRGB::Yellow;
-    }
-    else if (color == "white")
-    {
-        currentColor = CRGB::White;
-    }
-    else
+    if (!parseColor(color, value))
     {
         server.send(400, "text/plain", "Invalid color");
         return;
     }
 
-    if (currentMode == MODE_SOLID)
-    {
-        setStripColor(currentColor);
-    }
-
+    stageColor(value);
     server.send(200, "text/plain", "Color set to " + color);
-    Serial.println("LED Strip color: " + color);
+    LOG_D("WEB", "LED Strip color: %s", color.c_str());
 }
 
 void handleAutoUpdateWeb()
@@ -224,26 +248,34 @@ void handleAutoUpdateWeb()
     {
         autoUpdateEnabled = true;
         server.send(200, "text/plain", "Auto-update enabled");
-        Serial.println("Auto-update enabled via web");
+        LOG_I("WEB", "Auto-update enabled via web");
     }
     else if (action == "disable")
     {
         autoUpdateEnabled = false;
         server.send(200, "text/plain", "Auto-update disabled");
-        Serial.println("Auto-update disabled via web");
+        LOG_I("WEB", "Auto-update disabled via web");
     }
     else if (action == "now")
     {
         if (latestVersion != "" && latestVersion != ("v" + FIRMWARE_VERSION))
         {
-            checkForFirmwareUpdate(); // This will trigger the update
             server.send(200, "text/plain", "Update started");
+            checkForFirmwareUpdate(true); // Installs even outside the rollout
         }
         else
         {
             server.send(200, "text/plain", "No update available");
         }
     }
+    else if (action == "manifest")
+    {
+        // /auto-update/manifest?url=http://... - empty url goes back to GitHub
+        if (setManifestUrl(server.arg("url")))
+            server.send(200, "text/plain", "Update manifest set");
+        else
+            server.send(400, "text/plain", "Invalid manifest URL");
+    }
     else
     {
         server.send(400, "text/plain", "Invalid action");
@@ -254,8 +286,39 @@ void handleMusicData()
 {
     if (server.method() == HTTP_POST)
     {
+        // Same "band1,...,beat" text as the serial music: command, or
+        // {"bands":[...],"beat":n}. Goes through the latest-wins mailbox.
         String body = server.arg("plain");
-        Serial.println("Music data received: " + body);
+        MusicFrame frame;
+        bool valid;
+
+        if (body.startsWith("{"))
+        {
+            DynamicJsonDocument doc(512);
+            valid = !deserializeJson(doc, body) && doc.containsKey("beat");
+            if (valid)
+            {
+                JsonVariant bands = doc["bands"];
+                frame.receivedUs = micros();
+                frame.beat = constrain(doc["beat"].as<int>(), 0, 100);
+                frame.bandCount = min(bands.size(), (size_t)MUSIC_BANDS);
+                for (int i = 0; i < frame.bandCount; i++)
+                {
+                    frame.bands[i] = constrain(bands[i].as<int>(), 0, 100);
+                }
+            }
+        }
+        else
+        {
+            valid = parseMusicData(body, frame);
+        }
+
+        if (!valid)
+        {
+            server.send(400, "text/plain", "Invalid music data");
+            return;
+        }
+        postMusicFrame(frame);
         server.send(200, "application/json", "{\"status\":\"ok\"}");
     }
     else
@@ -263,3 +326,256 @@ void handleMusicData()
         server.send(405, "text/plain", "Method not allowed");
     }
 }
+
+static void sendStateJson(const StripState &state)
+{
+    char json[128];
+    snprintf(json, sizeof(json),
+             "{\"mode\":\"%s\",\"color\":\"#%02x%02x%02x\",\"brightness\":%u,\"speed\":%u}",
+             ledModeName(state.mode), state.color.r, state.color.g, state.color.b,
+             state.brightness, state.speed);
+    server.send(200, "application/json", json);
+}
+
+void handleStateApi()
+{
+    if (server.method() != HTTP_POST)
+    {
+        sendStateJson(pendingState);
+        return;
+    }
+
+    DynamicJsonDocument doc(512);
+    if (deserializeJson(doc, server.arg("plain")))
+    {
+        server.send(400, "text/plain", "Invalid JSON");
+        return;
+    }
+
+    // Validate every field into a copy first so a bad request changes nothing
+    StripState next = pendingState;
+
+    if (doc.containsKey("scene") && !loadScene(doc["scene"].as<String>(), next))
+    {
+        server.send(404, "text/plain", "Scene not found");
+        return;
+    }
+    if (doc.containsKey("mode") && !parseLedMode(doc["mode"].as<String>(), next.mode))
+    {
+        server.send(400, "text/plain", "Invalid mode");
+        return;
+    }
+    if (doc.containsKey("color") && !parseColor(doc["color"].as<String>(), next.color))
+    {
+        server.send(400, "text/plain", "Invalid color");
+        return;
+    }
+    if (doc.containsKey("brightness"))
+    {
+        int brightness = doc["brightness"] | -1;
+        if (brightness < 0 || brightness > 255)
+        {
+            server.send(400, "text/plain", "Invalid brightness (0-255)");
+            return;
+        }
+        next.brightness = brightness;
+    }
+    if (doc.containsKey("speed"))
+    {
+        int speed = doc["speed"] | -1;
+        if (speed < 1 || speed > 255)
+        {
+            server.send(400, "text/plain", "Invalid speed (1-255)");
+            return;
+        }
+        next.speed = speed;
+    }
+    if (doc.containsKey("save") && !saveScene(doc["save"].as<String>(), next))
+    {
+        server.send(400, "text/plain", "Invalid scene name");
+        return;
+    }
+
+    // "at" defers the change to a time on the shared clock
+    if (doc.containsKey("at"))
+    {
+        if (!scheduleState(doc["at"].as<uint32_t>(), next))
+        {
+            server.send(503, "text/plain", "Schedule full");
+            return;
+        }
+        sendStateJson(next);
+        return;
+    }
+
+    // All changes land together on the next frame
+    stageState(next);
+    sendStateJson(next);
+    LOG_D("WEB", "State updated: %s", ledModeName(next.mode));
+}
+
+void handleTimelineUpload()
+{
+    HTTPUpload &upload = server.upload();
+
+    if (upload.status == UPLOAD_FILE_START)
+    {
+        timelineUploadBegin();
+    }
+    else if (upload.status == UPLOAD_FILE_WRITE)
+    {
+        timelineUploadWrite(upload.buf, upload.currentSize);
+    }
+}
+
+void handleTimelineUploadDone()
+{
+    if (timelineUploadEnd())
+    {
+        server.send(200, "application/json", "{\"status\":\"ok\",\"cues\":" + String(timelineCueCount) + "}");
+    }
+    else
+    {
+        server.send(400, "text/plain", "Invalid timeline file");
+    }
+}
+
+// Multipart firmware upload, streamed straight into the OTA partition.
+// Optional query arguments: sha256=<hex> to verify, size=<bytes> for progress.
+void handleFirmwareUpload()
+{
+    HTTPUpload &upload = server.upload();
+
+    if (upload.status == UPLOAD_FILE_START)
+    {
+        otaInProgress = firmwareBegin(server.arg("size").toInt(), server.arg("sha256"));
+    }
+    else if (upload.status == UPLOAD_FILE_WRITE)
+    {
+        if (firmwareWriting)
+            firmwareWrite(upload.buf, upload.currentSize);
+    }
+    else if (upload.status == UPLOAD_FILE_END)
+    {
+        if (firmwareWriting)
+            firmwareEnd();
+        otaInProgress = false;
+    }
+    else if (upload.status == UPLOAD_FILE_ABORTED)
+    {
+        firmwareAbort();
+        otaInProgress = false;
+    }
+}
+
+void handleFirmwareUploadDone()
+{
+    if (firmwareWriting || firmwareError[0] != '\0' || firmwareWritten == 0)
+    {
+        firmwareAbort();
+        otaInProgress = false;
+        server.send(500, "text/plain", String("Update failed: ") + (firmwareError[0] ? firmwareError : "no data"));
+        return;
+    }
+
+    server.send(200, "text/plain", "Update complete, restarting");
+    logFlushAll();
+    delay(100);
+    ESP.restart();
+}
+
+void handlePixelMapUpload()
+{
+    HTTPUpload &upload = server.upload();
+
+    if (upload.status == UPLOAD_FILE_START)
+    {
+        pixelMapUploadBegin();
+    }
+    else if (upload.status == UPLOAD_FILE_WRITE)
+    {
+        pixelMapUploadWrite(upload.buf, upload.currentSize);
+    }
+}
+
+void handlePixelMapUploadDone()
+{
+    if (pixelMapUploadEnd())
+    {
+        server.send(200, "application/json", "{\"status\":\"ok\",\"width\":" + String(mapWidth) +
+                                                 ",\"height\":" + String(mapHeight) + "}");
+    }
+    else
+    {
+        server.send(400, "text/plain", "Invalid pixel map file");
+    }
+}
+
+// GET returns the stored effect program, POST compiles and stores a new one
+void handleEffectApi()
+{
+    if (server.method() != HTTP_POST)
+    {
+        server.send(200, "text/plain", vmSource);
+        return;
+    }
+
+    char error[48];
+    if (vmLoadProgram(server.arg("plain"), error, sizeof(error)))
+        server.send(200, "application/json", "{\"status\":\"ok\",\"instructions\":" + String(vmProgram.length) + "}");
+    else
+        server.send(400, "text/plain", String("Compile error ") + error);
+}
+
+void handleTimelineWeb()
+{
+    String action = server.pathArg(0);
+
+    if (action == "play")
+    {
+        if (timelinePlay())
+            server.send(200, "text/plain", "Timeline playing");
+        else
+            server.send(404, "text/plain", "No timeline stored");
+    }
+    else if (action == "stop")
+    {
+        timelineStop();
+        server.send(200, "text/plain", "Timeline stopped");
+    }
+    else if (action == "seek")
+    {
+        if (timelineSeek(server.arg("ms").toInt()))
+            server.send(200, "text/plain", "Timeline at " + String(timelinePositionMs) + " ms");
+        else
+            server.send(404, "text/plain", "No timeline stored");
+    }
+    else
+    {
+        server.send(400, "text/plain", "Invalid action");
+    }
+}
+
+void handleCaptureDownload()
+{
+    // Last capture, or a stored golden with ?golden=<name>
+    String path = CAPTURE_PATH;
+    if (server.hasArg("golden"))
+    {
+        if (!isValidSceneName(server.arg("golden")))
+        {
+            server.send(400, "text/plain", "Invalid capture name");
+            return;
+        }
+        path = String(CAPTURE_GOLDEN_PREFIX) + server.arg("golden") + ".lcp";
+    }
+
+    File file = LittleFS.open(path, "r");
+    if (!file || captureActive)
+    {
+        server.send(404, "text/plain", "No capture available");
+        return;
+    }
+    server.streamFile(file, "application/octet-stream");
+    file.close();
+}
@@ -2,9 +2,18 @@
 
 # ESP32 USB Serial Test Script
 # This script demonstrates how to control the ESP32 music visualizer via USB serial
+#
+# Usage:
+#   ./test_usb_serial.sh                      Run the demo command sequence
+#   ./test_usb_serial.sh replay FILE [SPEED]  Replay recorded traffic, then report latency
+#
+# Recording format for replay (one input per line, '#' starts a comment):
+#   <ms from start> serial <command>
+#   <ms from start> http <path> [body]        (set ESP32_HOST to the device IP)
+# SPEED scales the timing: 1 = original, 4 = four times faster.
 
 # Find the ESP32 device (usually /dev/ttyUSB0 on Linux, /dev/cu.usbserial-* on Mac)
-DEVICE="/dev/ttyUSB0"  # Change this to match your system
+DEVICE="${ESP32_DEVICE:-/dev/ttyUSB0}"  # Change this to match your system
 
 # Check if device exists
 if [ ! -e "$DEVICE" ]; then
@@ -13,10 +22,6 @@ if [ ! -e "$DEVICE" ]; then
     exit 1
 fi
 
-echo "=== ESP32 Music Visualizer USB Serial Test ==="
-echo "Device: $DEVICE"
-echo ""
-
 # Function to send command and wait
 send_command() {
     echo "Sending: $1"
@@ -24,6 +29,81 @@ send_command() {
     sleep 2
 }
 
+# Replays a recording at its original (or scaled) timing. The device measures
+# input-to-display latency itself, so the numbers printed at the end cover
+# the whole path from the host write to the frame that shows it.
+replay_traffic() {
+    local file="$1"
+    local speed="${2:-1}"
+
+    if [ ! -f "$file" ]; then
+        echo "Recording not found: $file"
+        exit 1
+    fi
+
+    local log
+    log=$(mktemp)
+    stty -F "$DEVICE" 115200 raw -echo 2>/dev/null
+    cat "$DEVICE" > "$log" &
+    local reader=$!
+    exec 3>"$DEVICE"
+
+    echo "=== Replaying $file at ${speed}x ==="
+    printf 'quiet:on\nmetrics:reset\n' >&3
+    sleep 1
+
+    local us_per_ms
+    us_per_ms=$(awk -v k="$speed" 'BEGIN { printf "%d", 1000 / k }')
+    local start=${EPOCHREALTIME/./}
+    local sent=0 max_late=0
+
+    while read -r at channel rest; do
+        [[ -z "$at" || "$at" == \#* ]] && continue
+
+        local due=$((start + at * us_per_ms))
+        local now=${EPOCHREALTIME/./}
+        if ((due > now)); then
+            local wait=$((due - now))
+            sleep "$(printf '%d.%06d' $((wait / 1000000)) $((wait % 1000000)))"
+        fi
+
+        # How far behind schedule the host itself is running
+        now=${EPOCHREALTIME/./}
+        ((now - due > max_late)) && max_late=$((now - due))
+
+        if [ "$channel" = "http" ]; then
+            local path="${rest%% *}"
+            local body=""
+            [ "$path" != "$rest" ] && body="${rest#* }"
+            curl -s -o /dev/null -m 2 -X POST --data "$body" "http://${ESP32_HOST}${path}" &
+        else
+            printf '%s\n' "$rest" >&3
+        fi
+        sent=$((sent + 1))
+    done < "$file"
+
+    local elapsed=$(((${EPOCHREALTIME/./} - start) / 1000))
+    sleep 1
+    printf 'latency\nmetrics\nquiet:off\n' >&3
+    sleep 1
+    kill "$reader" 2>/dev/null
+    exec 3>&-
+    wait 2>/dev/null
+
+    echo "Sent $sent inputs in ${elapsed} ms (host was at most $((max_late / 1000)) ms behind schedule)"
+    grep -a -E "RESPONSE:(Input|Frames)" "$log" | tr -d '\r'
+    rm -f "$log"
+}
+
+if [ "$1" = "replay" ]; then
+    replay_traffic "$2" "$3"
+    exit 0
+fi
+
+echo "=== ESP32 Music Visualizer USB Serial Test ==="
+echo "Device: $DEVICE"
+echo ""
+
 # Test sequence
 echo "Starting test sequence..."
 echo ""